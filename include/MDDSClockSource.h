@@ -0,0 +1,65 @@
+#pragma once
+
+#include "cinder/Thread.h"
+
+#include <random>
+
+namespace mdds {
+
+class ClockSource;
+typedef std::shared_ptr< ClockSource > ClockSourceRef;
+
+//! A master clock for a Movie to follow, such as incoming timecode, another
+// machine's playhead or an audio device's clock.
+class ClockSource
+{
+public:
+    virtual ~ClockSource() {}
+
+    //! Returns the master's position on the movie's timeline, in seconds.
+    // Called from the movie's loader thread once per frame, so it should be
+    // cheap and thread-safe. Readings may be noisy, the movie smooths them.
+    virtual double                  getTime() = 0;
+};
+
+
+class SimulatedClock;
+typedef std::shared_ptr< SimulatedClock > SimulatedClockRef;
+
+//! A local clock with adjustable rate, drift and jitter, for trying out clock
+// following without any external hardware.
+class SimulatedClock : public ClockSource
+{
+public:
+    static SimulatedClockRef create( const double rate=1.0 )
+    { return (SimulatedClockRef)(new SimulatedClock( rate )); }
+
+    SimulatedClock( const double rate=1.0 );
+
+    double                          getTime();
+
+    //! Sets the nominal rate, 1 being real time. The position carries on from
+    // where it is.
+    void                            setRate( const double rate );
+    double                          getRate() const;
+
+    //! Makes the clock run fast or slow by \a fraction of its rate, like a
+    // crystal that's slightly off.
+    void                            setDrift( const double fraction );
+    //! Adds gaussian noise with a standard deviation of \a seconds to every
+    // reading.
+    void                            setJitter( const double seconds );
+
+    //! Jumps to \a seconds, like the master being seeked
+    void                            setTime( const double seconds );
+protected:
+    mutable std::mutex              mMutex;
+    double                          mRate, mDrift, mJitter;
+    double                          mBaseTime, mBasePosition;
+    std::mt19937                    mRandom;
+    std::normal_distribution< double > mNoise;
+
+    double                          getPosition( const double now ) const;
+};
+
+}
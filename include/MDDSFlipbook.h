@@ -0,0 +1,86 @@
+#pragma once
+
+#include "cinder/gl/gl.h"
+#include "cinder/gl/GlslProg.h"
+#include "cinder/Filesystem.h"
+
+#include "MDDSTexture.h"
+
+// EXT_texture_array and GL 3.0 share the same token
+#ifndef GL_TEXTURE_2D_ARRAY
+#define GL_TEXTURE_2D_ARRAY             0x8C1A
+#endif
+
+namespace mdds {
+
+class Flipbook;
+typedef std::shared_ptr< Flipbook > FlipbookRef;
+
+//! A short sequence loaded once into a single GL_TEXTURE_2D_ARRAY, one layer
+// per frame. Playing it back only changes which layer is drawn, so there's no
+// per-frame I/O or upload, and any number of movies can share one flipbook.
+class Flipbook
+{
+    // Exception handling ------------------------------------------------------
+public:
+    class Error : public std::runtime_error
+    {
+    public:
+        Error( const std::string &what ) : std::runtime_error( what ) {}
+    };
+
+
+    // Construction/Destruction ------------------------------------------------
+public:
+    //! Factory method to load all frames in \a directory into a flipbook.
+    static FlipbookRef create( const ci::fs::path &directory, const std::string &extension=".DDS", const double fps=29.97, const size_t numThreads=0 )
+    { return (FlipbookRef)(new Flipbook( directory, extension, fps, numThreads )); }
+
+    //! Reads all frames in \a directory on \a numThreads threads (one per core
+    // if 0), then uploads them to the array one mip level at a time. Must be
+    // called with a GL context current. All frames must have the same size
+    // and format, and cubemaps aren't supported.
+    Flipbook( const ci::fs::path &directory, const std::string &extension=".DDS", const double fps=29.97, const size_t numThreads=0 );
+
+    ~Flipbook();
+
+    //! Owns its GL texture, share it through a FlipbookRef instead of copying
+    Flipbook( const Flipbook & ) = delete;
+    Flipbook &                      operator=( const Flipbook & ) = delete;
+
+    //! Returns the bytes a flipbook of \a directory would occupy on the GPU,
+    // having read only the first frame's header.
+    static size_t                   estimateMemoryUsage( const ci::fs::path &directory, const std::string &extension=".DDS" );
+
+
+    // Frames ------------------------------------------------------------------
+public:
+    size_t                          getNumFrames() const { return mNumFrames; }
+    double                          getFrameRate() const { return mFrameRate; }
+    int32_t                         getWidth() const { return mInfo.width; }
+    int32_t                         getHeight() const { return mInfo.height; }
+    //! Returns the bytes the array occupies on the GPU
+    size_t                          getMemoryUsage() const { return mInfo.getLayerSize() * mNumFrames; }
+
+
+    // Drawing -----------------------------------------------------------------
+public:
+    GLuint                          getId() const { return mTextureID; }
+    GLenum                          getTarget() const { return GL_TEXTURE_2D_ARRAY; }
+
+    //! Binds the array, for drawing with your own sampler2DArray shader.
+    void                            bind( GLuint textureUnit=0 ) const;
+    void                            unbind( GLuint textureUnit=0 ) const;
+
+    //! Draws \a layer into \a rect. When drawing many sprites, use bind() and
+    // your own shader instead so the array is only bound once.
+    void                            draw( const size_t layer, const ci::Rectf &rect ) const;
+protected:
+    GLuint                          mTextureID;
+    size_t                          mNumFrames;
+    double                          mFrameRate;
+    Texture::DdsInfo                mInfo;
+    mutable ci::gl::GlslProg        mDrawShader;
+};
+
+}
@@ -3,10 +3,16 @@
 #include "cinder/gl/gl.h"
 #include "cinder/Thread.h"
 #include "cinder/DataSource.h"
+#include "cinder/Vector.h"
 
 #include "MDDSTexture.h"
+#include "MDDSProxyTrack.h"
+#include "MDDSFlipbook.h"
+#include "MDDSClockSource.h"
+#include "MDDSVerifier.h"
 
 #include <atomic>
+#include <map>
 
 namespace mdds {
 
@@ -44,7 +50,22 @@ public:
     // \a extension will be skipped. \a fps sets the framerate of the movie.
     Movie( const ci::fs::path &directory, const std::string &extension=".DDS", const double fps=29.97 );
 
+    //! Factory method to create a movie that plays \a flipbook.
+    static MovieRef create( const FlipbookRef &flipbook )
+    { return (MovieRef)(new Movie( flipbook )); }
+
+    //! Construct a movie that plays \a flipbook, at the flipbook's frame rate.
+    // Playback only changes which layer is drawn, there's no loader thread.
+    Movie( const FlipbookRef &flipbook );
+
     ~Movie();
+protected:
+    Movie( const double fps );
+public:
+
+    //! Returns the paths of all frames in \a directory whose extension matches
+    // \a extension, in playback order.
+    static std::vector< ci::fs::path > listFramePaths( const ci::fs::path &directory, const std::string &extension=".DDS" );
 
     // Lifecycle ---------------------------------------------------------------
 public:
@@ -103,42 +124,253 @@ protected:
     void                            readFramePaths();
     std::atomic< size_t >           mCurrentFrameIdx, mNumFrames;
     std::atomic< bool >             mCurrentFrameIsFresh;
+    std::atomic< uint32_t >         mSeekGeneration;
 
 
     // Async -------------------------------------------------------------------
 protected:
     std::atomic< bool >             mThreadIsRunning, mDataIsFresh;
     std::thread                     mThread;
-    std::mutex                      mMutex;
-    bool                            mInterruptTriggeredFoRealz;
+    mutable std::mutex              mMutex;
+    std::atomic< bool >             mInterruptTriggeredFoRealz;
     std::condition_variable         mInterruptFrameRateSleepCv;
     void                            updateFrameThreadFn();
 
     struct thread_data {
         thread_data() :
-        buffer( nullptr ), extension("")
+        extension(""), dataGeneration( 0 )
         {}
 
         std::string                 extension;
         ci::fs::path                directoryPath;
-        ci::DataSourceBufferRef     buffer;
+        ::mdds::Texture::DdsData    data;
+        //! The seek generation that was current when \a data was requested
+        uint32_t                    dataGeneration;
         std::vector< ci::fs::path > framePaths;
     };
     thread_data                     mThreadData;
 
 
+    // Prefetch ----------------------------------------------------------------
+public:
+    //! What the loader has measured about the storage the movie is on, and
+    // what it decided to do about it.
+    struct PrefetchStats {
+        PrefetchStats() :
+        readLatency( 0 ), readLatencyDeviation( 0 ), throughput( 0 ), frameSize( 0 ),
+        depth( 0 ), bufferedFrames( 0 ), memoryUsage( 0 ), isBandwidthLimited( false ), underruns( 0 )
+        {}
+
+        //! Running mean and standard deviation of the seconds to read a frame
+        double                      readLatency, readLatencyDeviation;
+        //! Bytes per second while reading
+        double                      throughput;
+        //! Running mean of the bytes in a frame
+        size_t                      frameSize;
+        //! How many frames ahead of the playhead the loader reads
+        size_t                      depth;
+        //! Frames currently read ahead, and the bytes they occupy
+        size_t                      bufferedFrames, memoryUsage;
+        //! True when the storage can't keep up at the current play rate, or
+        // the memory limit keeps the depth below what's needed
+        bool                        isBandwidthLimited;
+        //! Frames that were due during playback before they had been read
+        uint32_t                    underruns;
+    };
+
+    //! Returns the loader's current estimates and decisions
+    PrefetchStats                   getPrefetchStats() const;
+
+    //! Caps the memory used by frames read ahead of the playhead. Defaults to
+    // 256MB.
+    void                            setPrefetchMemoryLimit( const size_t bytes );
+    size_t                          getPrefetchMemoryLimit() const;
+
+    //! The loader reads far enough ahead that a slow read causes an underrun
+    // with at most this probability, memory limit permitting. Defaults to
+    // 0.01.
+    void                            setTargetUnderrunProbability( const double probability );
+    double                          getTargetUnderrunProbability() const;
+protected:
+    std::atomic< size_t >           mPrefetchMemoryLimit;
+    std::atomic< double >           mTargetUnderrunProbability;
+    PrefetchStats                   mPrefetchStats;
+
+    // Loader thread only
+    std::map< size_t, ::mdds::Texture::DdsData > mPrefetched;
+    double                          mReadLatencyMean, mReadLatencyVariance, mFrameSizeMean;
+    uint32_t                        mNumReads, mUnderruns;
+
+    bool                            readFrame( const size_t frame, const uint8_t faceMask, ::mdds::Texture::DdsData &data );
+    bool                            takePrefetchedFrame( const size_t frame, const uint8_t faceMask, ::mdds::Texture::DdsData &data );
+    void                            prefetchFrames( const double secondsPerFrame, const uint8_t faceMask );
+    size_t                          stepFrame( const size_t frame, const int direction ) const;
+
+
     // Texture -----------------------------------------------------------------
 protected:
-    ::mdds::Texture                 mTexture;
+    //! The last full-resolution frame. Kept apart from the proxy so that a
+    // cubemap's hidden faces survive seeks.
+    ::mdds::Texture                 mTexture, mProxyTexture;
+public:
+    //! Returns a reference to the current frame's texture, which is the proxy
+    // texture while isShowingProxy(). Empty when playing a flipbook, see
+    // getFlipbook() and getFlipbookLayer().
+    const ci::gl::Texture &         getTexture() const { return mShowingProxy ? mProxyTexture : mTexture; }
+
+
+    // Proxy -------------------------------------------------------------------
+public:
+    //! Use \a proxy to show something immediately after a seek and while
+    // shuttling, until the full-resolution frame arrives. Pass nullptr to
+    // disable. Cubemap movies ignore the proxy, it only holds the first face.
+    void                            setProxy( const ProxyTrackRef &proxy );
+    //! Returns the proxy track, if any
+    ProxyTrackRef                   getProxy() const { return mProxy; }
+
+    //! While the absolute play rate is at or above \a rate, only proxy frames
+    // are shown and full-resolution frames aren't read at all.
+    void                            setProxyShuttleRate( const double rate );
+    double                          getProxyShuttleRate() const;
+
+    //! Returns whether the current texture is a proxy frame
+    bool                            isShowingProxy() const { return mShowingProxy; }
+
+    //! Returns the seconds between the last seek and the first texture showing
+    // the new position, whether proxy or full-resolution.
+    double                          getSeekTimeToFirstPixel() const { return mSeekTimeToFirstPixel; }
+    //! Returns the seconds between the last seek and its full-resolution frame
+    double                          getSeekTimeToFullFrame() const { return mSeekTimeToFullFrame; }
+    //! Returns the mean time to first pixel over all seeks so far
+    double                          getAverageSeekTimeToFirstPixel() const;
+protected:
+    ProxyTrackRef                   mProxy;
+    std::atomic< double >           mProxyShuttleRate;
+    std::atomic< size_t >           mProxyFrameIdx;
+    std::atomic< bool >             mProxyIsFresh;
+    bool                            mShowingProxy;
+    bool                            isShuttling() const;
+
+    std::atomic< double >           mSeekTime;
+    std::atomic< bool >             mAwaitingFirstPixel, mAwaitingFullFrame;
+    double                          mSeekTimeToFirstPixel, mSeekTimeToFullFrame, mSeekTimeToFirstPixelSum;
+    uint32_t                        mSeekCount;
+    void                            updateSeekTimes( const bool isFullFrame );
+
+
+    // Cubemaps ----------------------------------------------------------------
 public:
-    //! Returns a reference to the current frame's texture
-    const ci::gl::Texture &         getTexture() const { return mTexture; }
+    //! Only read and upload the cubemap faces in \a faceMask, a combination of
+    // Texture::FACE_* flags. Faces left out keep showing whatever they last
+    // showed. Has no effect on movies that aren't cubemaps.
+    void                            setVisibleFaces( const uint8_t faceMask );
+    uint8_t                         getVisibleFaces() const;
+
+    //! Only stream the faces that can be seen looking along \a direction with
+    // a field of view of \a fovDegrees, measured across the diagonal.
+    void                            setViewDirection( const ci::Vec3f &direction, const float fovDegrees );
+
+    //! Returns the faces of a cube, seen from its center, that intersect a
+    // cone around \a direction with an apex angle of \a fovDegrees.
+    static uint8_t                  facesVisibleFrom( const ci::Vec3f &direction, const float fovDegrees );
+protected:
+    std::atomic< uint8_t >          mVisibleFaces;
+    //! Whether the first frame is a cubemap, set by the constructor
+    bool                            mIsCubemap;
+
 
+    // Flipbook ----------------------------------------------------------------
+public:
+    //! Returns the flipbook this movie plays, if any
+    FlipbookRef                     getFlipbook() const { return mFlipbook; }
+    //! Returns the flipbook layer for the current frame
+    size_t                          getFlipbookLayer() const;
+protected:
+    FlipbookRef                     mFlipbook;
+    double                          mFlipbookLastUpdateTime, mFlipbookFramePhase;
+    void                            updateFlipbook();
+
+
+    // Clock following ---------------------------------------------------------
+public:
+    //! Follow \a clock instead of playing freely. Small errors are corrected
+    // by nudging the play rate, larger ones by seeking. While following, the
+    // play rate is set by the loader. Pass nullptr to stop following.
+    void                            setClockSource( const ClockSourceRef &clock );
+    ClockSourceRef                  getClockSource() const;
+
+    //! Errors larger than \a frames are corrected by seeking. Defaults to 15.
+    void                            setSyncSeekThreshold( const double frames );
+    double                          getSyncSeekThreshold() const;
+
+    //! The most that is added to or taken off the master's rate to correct an
+    // error, where 1 is the normal rate. A master slower than this, or
+    // stopped, is followed frame by frame instead. Defaults to 0.05.
+    void                            setSyncMaxRateCorrection( const double fraction );
+    double                          getSyncMaxRateCorrection() const;
+
+    //! How closely playback follows the clock, with errors in frames and
+    // positive meaning the master is ahead.
+    struct SyncStats {
+        SyncStats() :
+        error( 0 ), maxError( 0 ), errorSum( 0 ), errorSquaredSum( 0 ),
+        masterRate( 0 ), rateCorrection( 0 ), numSamples( 0 ), numSeeks( 0 )
+        {}
+
+        double                      getMeanError() const { return numSamples ? errorSum / numSamples : 0.0; }
+        double                      getRmsError() const { return numSamples ? sqrt( errorSquaredSum / numSamples ) : 0.0; }
+
+        //! The error at the last sample, and the largest absolute error
+        double                      error, maxError;
+        double                      errorSum, errorSquaredSum;
+        //! The master's smoothed rate, and the correction applied on top of it
+        double                      masterRate, rateCorrection;
+        uint32_t                    numSamples, numSeeks;
+    };
+    SyncStats                       getSyncStats() const;
+    void                            resetSyncStats();
+protected:
+    ClockSourceRef                  mClockSource;
+    std::atomic< double >           mSyncSeekThreshold, mSyncMaxRateCorrection;
+    SyncStats                       mSyncStats;
+
+    // Loader thread only
+    bool                            mClockIsLocked;
+    double                          mClockPosition, mClockRate, mClockSampleTime;
+    //! Fraction of a frame the play rate has covered since the last step
+    double                          mClockFramePhase;
+    void                            followClock( const ClockSourceRef &clock );
+
+
+    // Verification ------------------------------------------------------------
+public:
+    //! Never read the frames listed in the index at \a path, written by
+    // Verifier::Report::writeIndex(). The previous frame stays up instead.
+    // An index of the proxy track keeps its bad frames from being shown.
+    void                            loadVerificationIndex( const ci::fs::path &path );
+    //! Never read the frames \a report found bad
+    void                            setVerificationReport( const Verifier::Report &report );
+    //! Never read the frames listed in \a index
+    void                            setVerificationIndex( const Verifier::Index &index );
+    //! Returns the number of frames, full-resolution and proxy, that are
+    // being skipped
+    size_t                          getNumBadFrames() const;
+protected:
+    typedef std::shared_ptr< const std::vector< bool > > BadFramesRef;
+    BadFramesRef                    mBadFrames;
+    // Loader thread only
+    BadFramesRef                    mLoaderBadFrames;
+    bool                            isBadFrame( const size_t frame ) const;
+    // Main thread only
+    std::vector< bool >             mBadProxyFrames;
 
     // Position control --------------------------------------------------------
 protected:
     std::atomic< bool >             mLoopEnabled;
     void                            nextFramePosition();
+    //! Moves \a steps frames forward, or backward if negative, wrapping or
+    // stopping at the ends
+    void                            advanceFrames( const int64_t steps );
     
 };
 }
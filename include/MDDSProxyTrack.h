@@ -0,0 +1,79 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+#include "cinder/Buffer.h"
+#include "cinder/Stream.h"
+
+#include "MDDSTexture.h"
+
+namespace mdds {
+
+class ProxyTrack;
+typedef std::shared_ptr< ProxyTrack > ProxyTrackRef;
+
+//! A low-resolution, DXT1-compressed copy of every frame in a sequence, packed
+// into a single file and held in memory so that any frame can be shown
+// without touching the full-resolution sequence.
+class ProxyTrack
+{
+    // Exception handling ------------------------------------------------------
+public:
+    class Error : public std::runtime_error
+    {
+    public:
+        Error( const std::string &what ) : std::runtime_error( what ) {}
+    };
+
+
+    // Construction/Destruction ------------------------------------------------
+public:
+    //! Factory method to load the proxy track stored at \a path.
+    static ProxyTrackRef create( const ci::fs::path &path )
+    { return (ProxyTrackRef)(new ProxyTrack( path )); }
+
+    //! Loads the proxy track stored at \a path into memory.
+    ProxyTrack( const ci::fs::path &path );
+
+
+    // Generation --------------------------------------------------------------
+public:
+    //! Writes a proxy track for all frames in \a directory to \a path. Each
+    // frame is downsampled by \a scale in each dimension and re-encoded as
+    // DXT1. Frames are ordered the same way Movie orders them.
+    static void                     generate( const ci::fs::path &directory, const ci::fs::path &path, const std::string &extension=".DDS", const uint32_t scale=8 );
+
+    //! Returns where a proxy track for \a directory lives by default: a
+    // sidecar file next to the directory, named after it.
+    static ci::fs::path             getDefaultPath( const ci::fs::path &directory );
+
+
+    // Frames ------------------------------------------------------------------
+public:
+    //! Returns the number of frames in the proxy track
+    size_t                          getNumFrames() const { return mFrames.size(); }
+
+    //! Uploads the proxy for \a frame to a new texture. Throws Error if the
+    // frame runs past the end of the file.
+    Texture                         loadTexture( const size_t frame ) const;
+
+    //! Returns the number of bytes the proxy track occupies in memory
+    size_t                          getDataSize() const { return mBuffer.getDataSize(); }
+
+
+    // File layout -------------------------------------------------------------
+public:
+    //! Where a frame's DDS file lives within the packed file
+    struct FrameEntry {
+        uint64_t                    offset;
+        uint32_t                    size;
+    };
+
+    //! Reads the header and frame table of a packed proxy file from the start
+    // of \a stream. Entries aren't checked against the size of the file.
+    static std::vector< FrameEntry > readFrameTable( ci::IStreamRef stream );
+protected:
+    ci::Buffer                      mBuffer;
+    std::vector< FrameEntry >       mFrames;
+};
+
+}
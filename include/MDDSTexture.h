@@ -1,6 +1,22 @@
 #pragma once
 
 #include "cinder/gl/Texture.h"
+#include "cinder/Buffer.h"
+
+// BC4/BC5, from ARB_texture_compression_rgtc, which older headers lack
+#ifndef GL_COMPRESSED_RED_RGTC1
+#define GL_COMPRESSED_RED_RGTC1         0x8DBB
+#define GL_COMPRESSED_SIGNED_RED_RGTC1  0x8DBC
+#define GL_COMPRESSED_RG_RGTC2          0x8DBD
+#define GL_COMPRESSED_SIGNED_RG_RGTC2   0x8DBE
+#endif
+
+// sRGB DXT1/3/5, from EXT_texture_sRGB
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT  0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT  0x8C4E
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT  0x8C4F
+#endif
 
 namespace mdds {
 
@@ -15,9 +31,84 @@ public:
 
     static void warn( const std::string &warning ) { std::cout << warning << std::endl; }
 
+    //! Cubemap faces, in GL_TEXTURE_CUBE_MAP_POSITIVE_X + n order
+    enum {
+        FACE_POSITIVE_X = 1 << 0,
+        FACE_NEGATIVE_X = 1 << 1,
+        FACE_POSITIVE_Y = 1 << 2,
+        FACE_NEGATIVE_Y = 1 << 3,
+        FACE_POSITIVE_Z = 1 << 4,
+        FACE_NEGATIVE_Z = 1 << 5,
+        FACE_ALL        = 0x3f
+    };
+
+
+    //! Describes the layout of a DDS file's pixel data, as read from its
+    // header.
+    struct DdsInfo
+    {
+        DdsInfo();
+
+        uint32_t                    width, height, numMipMaps, numLayers;
+        GLenum                      dataFormat;
+        bool                        isCompressed, isCubemap;
+        //! Only set for cubemaps: the faces stored in the file
+        uint8_t                     faceMask;
+        //! Only set for uncompressed data
+        uint32_t                    bytesPerPixel;
+        //! Only set for compressed data
+        uint32_t                    blockSize;
+        //! Offset of the pixel data from the start of the file
+        size_t                      dataOffset;
+
+        //! Returns the size in bytes of mip \a level of a single layer
+        size_t                      getMipSize( uint32_t level ) const;
+        //! Returns the size in bytes of a single layer, including mipmaps
+        size_t                      getLayerSize() const;
+        //! Returns the size in bytes of all layers and mipmaps
+        size_t                      getDataSize() const;
+        //! Returns the offset from the start of the file of \a layer, which
+        // for cubemaps is a face index whether or not earlier faces are stored
+        size_t                      getLayerOffset( uint32_t layer ) const;
+    };
+
+    //! Pixel data for some or all layers of a DDS file
+    struct DdsData
+    {
+        DdsData() : faceMask( 0 ) {}
+
+        DdsInfo                     info;
+        //! The layers that were read. For cubemaps, bit n is face n.
+        uint8_t                     faceMask;
+        //! All mipmaps for each layer that was read, indexed by face. Layers
+        // that weren't read are empty buffers.
+        ci::Buffer                  layers[6];
+
+        //! Returns the bytes held by the layers that were read
+        size_t                      getDataSize() const
+        {
+            size_t size = 0;
+            for ( int face = 0; face < 6; ++face )
+                if ( faceMask & (1 << face) ) size += layers[ face ].getDataSize();
+            return size;
+        }
+    };
+
+    //! Reads the header of a DDS file, leaving \a ddsStream positioned at the
+    // start of the pixel data.
+    static DdsInfo readDdsInfo( ci::IStreamRef ddsStream );
+
+    //! Reads a DDS file. For cubemaps, only the faces in \a faceMask are read
+    // and the rest are skipped over, so \a ddsStream must be seekable.
+    static DdsData readDdsData( ci::IStreamRef ddsStream, uint8_t faceMask=FACE_ALL );
 
     static Texture loadDds( ci::IStreamRef ddsStream, Format format );
 
+    //! Uploads \a data to a texture. If \a reuse was made by this function and
+    // has the same target, size, format and number of mipmaps, \a data is uploaded into it and returned, and any cubemap faces
+    // missing from \a data keep their previous contents.
+    static Texture loadDds( const DdsData &data, Format format, const Texture &reuse=Texture() );
+
     //! Default initializer. Points to a null Obj
 	Texture() : ci::gl::Texture() {}
 
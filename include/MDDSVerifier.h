@@ -0,0 +1,103 @@
+#pragma once
+
+#include "cinder/Filesystem.h"
+
+#include "MDDSTexture.h"
+
+#include <ostream>
+
+namespace mdds {
+
+//! Checks every frame of a sequence or packed proxy file before a show, on a
+// pool of threads. Only headers are read and payload sizes are checked
+// against file sizes, so a scan runs at roughly the speed of listing the
+// files. The resulting index lets a Movie skip known-bad frames for free.
+class Verifier
+{
+public:
+    class Error : public std::runtime_error
+    {
+    public:
+        Error( const std::string &what ) : std::runtime_error( what ) {}
+    };
+
+    enum Status {
+        FRAME_OK,
+        //! The file couldn't be opened or read
+        FRAME_UNREADABLE,
+        //! Not a DDS file, or a header we can't make sense of
+        FRAME_BAD_HEADER,
+        //! Shorter than its header says it should be
+        FRAME_TRUNCATED,
+        //! Readable, but a different size or format from most of the sequence
+        FRAME_MISMATCHED
+    };
+    static const char *             getStatusName( const Status status );
+
+    struct FrameReport {
+        FrameReport() :
+        frame( 0 ), status( FRAME_OK ), width( 0 ), height( 0 ), dataFormat( 0 ), numMipMaps( 0 ), isCubemap( false ), expectedSize( 0 ), actualSize( 0 )
+        {}
+
+        //! Position in playback order
+        size_t                      frame;
+        //! For packed files, the path of the packed file
+        ci::fs::path                path;
+        Status                      status;
+        std::string                 message;
+        uint32_t                    width, height;
+        GLenum                      dataFormat;
+        uint32_t                    numMipMaps;
+        bool                        isCubemap;
+        //! Bytes the header describes, and bytes actually there
+        uint64_t                    expectedSize, actualSize;
+    };
+
+    //! The bad frames of a scan, as stored in an index file. Frames of a
+    // sequence are matched by file name, so the index survives frames being
+    // added or removed. Frames of a packed file all share its name, so
+    // they're matched by position.
+    struct Index {
+        Index() : isPacked( false ) {}
+
+        bool                        isPacked;
+        std::vector< size_t >       frames;
+        std::vector< std::string >  fileNames;
+    };
+
+    struct Report {
+        Report() : isPacked( false ) {}
+
+        //! One entry per frame, in playback order
+        std::vector< FrameReport >  frames;
+        //! True for a scan of a packed file
+        bool                        isPacked;
+
+        size_t                      getNumBadFrames() const;
+        bool                        isOk() const { return getNumBadFrames() == 0; }
+
+        //! Writes a human-readable summary and the list of bad frames
+        void                        write( std::ostream &os ) const;
+
+        //! Returns the bad frames, for Movie::setVerificationIndex()
+        Index                       getIndex() const;
+        //! Writes the bad frames to an index file for Movie::loadVerificationIndex()
+        void                        writeIndex( const ci::fs::path &path ) const;
+    };
+
+    //! Scans all frames in \a directory, on \a numThreads threads (one per
+    // core if 0).
+    static Report                   scanSequence( const ci::fs::path &directory, const std::string &extension=".DDS", const size_t numThreads=0 );
+
+    //! Scans every frame packed into the proxy track at \a path.
+    static Report                   scanProxyTrack( const ci::fs::path &path, const size_t numThreads=0 );
+
+    //! Returns where the index for \a path, a sequence directory or packed
+    // file, lives by default: a sidecar file next to it, named after it.
+    static ci::fs::path             getDefaultIndexPath( const ci::fs::path &path );
+
+    //! Reads an index written by Report::writeIndex().
+    static Index                    readIndex( const ci::fs::path &path );
+};
+
+}
@@ -25,6 +25,8 @@ public:
 
 protected:
     mdds::MovieRef          mMovie;
+    ci::fs::path            mMoviePath;
+    mdds::SimulatedClockRef mClock;
     ci::Font                mFont;
 };
 
@@ -51,12 +53,37 @@ MDDSSampleApp::setup()
 {
     try
     {
-        mMovie = mdds::Movie::create( getFolderPath(), ".DDS", 29.97 );
+        mMoviePath = getFolderPath();
+        mMovie = mdds::Movie::create( mMoviePath, ".DDS", 29.97 );
     }
     catch ( mdds::Movie::LoadError boom )
     {
         console() << "Error loading movie: " << boom.what() << endl;
     }
+
+    fs::path proxyPath = mdds::ProxyTrack::getDefaultPath( mMoviePath );
+    fs::path indexPath = mdds::Verifier::getDefaultIndexPath( mMoviePath );
+    fs::path proxyIndexPath = mdds::Verifier::getDefaultIndexPath( proxyPath );
+    try
+    {
+        if ( mMovie && fs::exists( indexPath ) ) mMovie->loadVerificationIndex( indexPath );
+        if ( mMovie && fs::exists( proxyIndexPath ) ) mMovie->loadVerificationIndex( proxyIndexPath );
+    }
+    catch ( mdds::Verifier::Error boom )
+    {
+        console() << "Error loading verification index: " << boom.what() << endl;
+    }
+    if ( mMovie && fs::exists( proxyPath ) )
+    {
+        try
+        {
+            mMovie->setProxy( mdds::ProxyTrack::create( proxyPath ) );
+        }
+        catch ( mdds::ProxyTrack::Error boom )
+        {
+            console() << "Error loading proxy: " << boom.what() << endl;
+        }
+    }
 }
 
 void
@@ -83,6 +110,17 @@ MDDSSampleApp::draw()
     info.addLine( (boost::format( "Movie FPS: %.2d" ) % mMovie->getFrameRate()).str() );
     info.addLine( (boost::format( "Play rate: %.2d" ) % mMovie->getPlayRate()).str() );
     info.addLine( (boost::format( "Average playback FPS: %.2d" ) % mMovie->getAverageFps()).str() );
+    info.addLine( (boost::format( "Seek time to first pixel: %.1fms (full frame: %.1fms)" ) % (mMovie->getSeekTimeToFirstPixel() * 1000.0) % (mMovie->getSeekTimeToFullFrame() * 1000.0)).str() );
+    mdds::Movie::PrefetchStats prefetch = mMovie->getPrefetchStats();
+    info.addLine( (boost::format( "Read: %.1fms ± %.1fms, %.1fMB/s%s" ) % (prefetch.readLatency * 1000.0) % (prefetch.readLatencyDeviation * 1000.0) % (prefetch.throughput / 1e6) % (prefetch.isBandwidthLimited ? " (limited)" : "")).str() );
+    info.addLine( (boost::format( "Prefetch: %d/%d frames, %.1fMB, %d underruns" ) % prefetch.bufferedFrames % prefetch.depth % (prefetch.memoryUsage / 1e6) % prefetch.underruns).str() );
+    if ( mMovie->getClockSource() )
+    {
+        mdds::Movie::SyncStats sync = mMovie->getSyncStats();
+        info.addLine( (boost::format( "Sync error: %.2f frames (rms %.2f, max %.2f), %d seeks" ) % sync.error % sync.getRmsError() % sync.maxError % sync.numSeeks).str() );
+    }
+    if ( mMovie->getNumBadFrames() > 0 ) info.addLine( (boost::format( "Skipping %d bad frames" ) % mMovie->getNumBadFrames()).str() );
+    info.addLine( mMovie->getProxy() ? (mMovie->isShowingProxy() ? "Proxy: showing" : "Proxy: loaded") : "Proxy: none" );
     info.addLine( "Controls:" );
     info.addLine( "↑: double playback rate" );
     info.addLine( "↓: halve playback rate" );
@@ -90,6 +128,9 @@ MDDSSampleApp::draw()
     info.addLine( "r: play reverse at normal rate" );
     info.addLine( "space: pause" );
     info.addLine( "↵: jump to random frame" );
+    info.addLine( "p: generate proxy track" );
+    info.addLine( "v: verify all frames and skip bad ones" );
+    info.addLine( "c: toggle following a drifting, jittery simulated clock" );
     gl::draw( gl::Texture( info.render( true ) ), Vec2f( 10, 10 ) );
 }
 
@@ -108,6 +149,59 @@ MDDSSampleApp::keyDown( KeyEvent event )
         mMovie->setPlayRate( 0.0 );
     else if ( event.getCode() == KeyEvent::KEY_RETURN )
         mMovie->seekToFrame( Rand::randInt( mMovie->getNumFrames() ) );
+    else if ( event.getChar() == 'c' )
+    {
+        if ( mMovie->getClockSource() )
+        {
+            mMovie->setClockSource( nullptr );
+            mMovie->setPlayRate( 1.0 );
+        }
+        else
+        {
+            mClock = mdds::SimulatedClock::create();
+            mClock->setTime( mMovie->getCurrentTime() );
+            mClock->setDrift( 0.002 );
+            mClock->setJitter( 0.004 );
+            mMovie->resetSyncStats();
+            mMovie->setClockSource( mClock );
+        }
+    }
+    else if ( event.getChar() == 'v' )
+    {
+        try
+        {
+            mdds::Verifier::Report report = mdds::Verifier::scanSequence( mMoviePath, ".DDS" );
+            report.write( console() );
+            report.writeIndex( mdds::Verifier::getDefaultIndexPath( mMoviePath ) );
+            mMovie->setVerificationReport( report );
+
+            fs::path proxyPath = mdds::ProxyTrack::getDefaultPath( mMoviePath );
+            if ( fs::exists( proxyPath ) )
+            {
+                mdds::Verifier::Report proxyReport = mdds::Verifier::scanProxyTrack( proxyPath );
+                proxyReport.write( console() );
+                proxyReport.writeIndex( mdds::Verifier::getDefaultIndexPath( proxyPath ) );
+                mMovie->setVerificationReport( proxyReport );
+            }
+        }
+        catch ( mdds::Verifier::Error boom )
+        {
+            console() << "Error verifying: " << boom.what() << endl;
+        }
+    }
+    else if ( event.getChar() == 'p' )
+    {
+        fs::path proxyPath = mdds::ProxyTrack::getDefaultPath( mMoviePath );
+        try
+        {
+            mdds::ProxyTrack::generate( mMoviePath, proxyPath, ".DDS" );
+            mMovie->setProxy( mdds::ProxyTrack::create( proxyPath ) );
+        }
+        catch ( mdds::ProxyTrack::Error boom )
+        {
+            console() << "Error generating proxy: " << boom.what() << endl;
+        }
+    }
 
 }
 
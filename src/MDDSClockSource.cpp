@@ -0,0 +1,77 @@
+#include "MDDSClockSource.h"
+#include "cinder/app/App.h"
+
+using namespace std;
+using namespace ci;
+using namespace mdds;
+
+/*******************************************************************************
+ * SimulatedClock
+ */
+
+SimulatedClock::SimulatedClock( const double rate ) :
+mRate( rate ),
+mDrift( 0 ),
+mJitter( 0 ),
+mBaseTime( app::getElapsedSeconds() ),
+mBasePosition( 0 ),
+mRandom( random_device()() )
+{
+}
+
+double
+SimulatedClock::getPosition( const double now ) const
+{
+    return mBasePosition + (now - mBaseTime) * mRate * (1.0 + mDrift);
+}
+
+double
+SimulatedClock::getTime()
+{
+    lock_guard< mutex > lock( mMutex );
+    double position = getPosition( app::getElapsedSeconds() );
+    if ( mJitter > 0 ) position += mNoise( mRandom ) * mJitter;
+    return position;
+}
+
+void
+SimulatedClock::setRate( const double rate )
+{
+    lock_guard< mutex > lock( mMutex );
+    double now = app::getElapsedSeconds();
+    mBasePosition = getPosition( now );
+    mBaseTime = now;
+    mRate = rate;
+}
+
+double
+SimulatedClock::getRate() const
+{
+    lock_guard< mutex > lock( mMutex );
+    return mRate;
+}
+
+void
+SimulatedClock::setDrift( const double fraction )
+{
+    lock_guard< mutex > lock( mMutex );
+    double now = app::getElapsedSeconds();
+    mBasePosition = getPosition( now );
+    mBaseTime = now;
+    mDrift = fraction;
+}
+
+void
+SimulatedClock::setJitter( const double seconds )
+{
+    lock_guard< mutex > lock( mMutex );
+    mJitter = seconds;
+}
+
+void
+SimulatedClock::setTime( const double seconds )
+{
+    lock_guard< mutex > lock( mMutex );
+    mBaseTime = app::getElapsedSeconds();
+    mBasePosition = seconds;
+}
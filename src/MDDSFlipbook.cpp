@@ -0,0 +1,170 @@
+#include "MDDSFlipbook.h"
+#include "MDDSMovie.h"
+#include "cinder/Stream.h"
+#include "cinder/Thread.h"
+
+#include <atomic>
+
+using namespace std;
+using namespace ci;
+using namespace mdds;
+
+static const char *DRAW_VERT = R"(
+#version 120
+void main()
+{
+    gl_TexCoord[0] = gl_MultiTexCoord0;
+    gl_Position = ftransform();
+}
+)";
+
+static const char *DRAW_FRAG = R"(
+#version 120
+#extension GL_EXT_texture_array : enable
+uniform sampler2DArray tex;
+uniform float layer;
+void main()
+{
+    gl_FragColor = texture2DArray( tex, vec3( gl_TexCoord[0].st, layer ) );
+}
+)";
+
+/*******************************************************************************
+ * Construction
+ */
+
+Flipbook::Flipbook( const fs::path &directory, const string &extension, const double fps, const size_t numThreads ) :
+mTextureID( 0 ),
+mNumFrames( 0 ),
+mFrameRate( fps )
+{
+    if ( !fs::exists( directory ) ) throw Error( directory.string() + " does not exist" );
+    if ( !fs::is_directory( directory ) ) throw Error( directory.string() + " is not a directory" );
+
+    vector< fs::path > framePaths = Movie::listFramePaths( directory, extension );
+    if ( framePaths.empty() ) throw Error( directory.string() + " has no frames" );
+
+    mNumFrames = framePaths.size();
+    mInfo = Texture::readDdsInfo( loadFileStream( framePaths[ 0 ] ) );
+    if ( mInfo.isCubemap ) throw Error( "cubemaps can't be loaded into a flipbook" );
+
+    // One staging buffer per mip level, holding that level of every frame
+    // back to back, which is how glCompressedTexImage3D wants it
+    vector< vector< uint8_t > > mips( mInfo.numMipMaps );
+    for ( uint32_t i = 0; i < mInfo.numMipMaps; ++i )
+        mips[ i ].resize( mInfo.getMipSize( i ) * mNumFrames );
+
+    atomic< size_t > nextFrame( 0 );
+    mutex errorMutex;
+    string error;
+
+    auto readFrames = [&] {
+        ci::ThreadSetup threadSetup;
+
+        for ( size_t frame = nextFrame++; frame < mNumFrames; frame = nextFrame++ )
+        {
+            try
+            {
+                Texture::DdsData data = Texture::readDdsData( loadFileStream( framePaths[ frame ] ) );
+                if ( data.info.width != mInfo.width || data.info.height != mInfo.height ||
+                     data.info.dataFormat != mInfo.dataFormat || data.info.numMipMaps != mInfo.numMipMaps || data.info.isCubemap )
+                    throw Error( "doesn't match the size and format of the first frame" );
+
+                const uint8_t *pixels = (const uint8_t *)data.layers[0].getData();
+                for ( uint32_t i = 0; i < mInfo.numMipMaps; ++i )
+                {
+                    size_t size = mInfo.getMipSize( i );
+                    memcpy( &mips[ i ][ frame * size ], pixels, size );
+                    pixels += size;
+                }
+            }
+            catch ( std::exception &boom )
+            {
+                lock_guard< mutex > lock( errorMutex );
+                if ( error.empty() ) error = framePaths[ frame ].string() + ": " + boom.what();
+                nextFrame = mNumFrames;
+            }
+        }
+    };
+
+    size_t threadCount = numThreads > 0 ? numThreads : max( 1u, thread::hardware_concurrency() );
+    vector< thread > threads;
+    for ( size_t i = 0; i < min( threadCount, mNumFrames ); ++i ) threads.push_back( thread( readFrames ) );
+    for ( auto &t : threads ) t.join();
+
+    if ( !error.empty() ) throw Error( error );
+
+    glGenTextures( 1, &mTextureID );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, mTextureID );
+    glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+    uint32_t width = mInfo.width, height = mInfo.height;
+    for ( uint32_t i = 0; i < mInfo.numMipMaps; ++i )
+    {
+        if ( mInfo.isCompressed )
+            glCompressedTexImage3D( GL_TEXTURE_2D_ARRAY, i, mInfo.dataFormat, width, height, mNumFrames, 0, mips[ i ].size(), &mips[ i ][ 0 ] );
+        else
+            glTexImage3D( GL_TEXTURE_2D_ARRAY, i, mInfo.dataFormat, width, height, mNumFrames, 0, mInfo.dataFormat, GL_UNSIGNED_BYTE, &mips[ i ][ 0 ] );
+
+        width = max( 1u, width >> 1 );
+        height = max( 1u, height >> 1 );
+    }
+
+    if ( mInfo.numMipMaps > 1 ) {
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, mInfo.numMipMaps - 1 );
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+    }
+    else {
+        glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+    }
+    glTexParameteri( GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+}
+
+Flipbook::~Flipbook()
+{
+    if ( mTextureID ) glDeleteTextures( 1, &mTextureID );
+}
+
+size_t
+Flipbook::estimateMemoryUsage( const fs::path &directory, const string &extension )
+{
+    vector< fs::path > framePaths = Movie::listFramePaths( directory, extension );
+    if ( framePaths.empty() ) return 0;
+
+    return Texture::readDdsInfo( loadFileStream( framePaths[ 0 ] ) ).getLayerSize() * framePaths.size();
+}
+
+/*******************************************************************************
+ * Drawing
+ */
+
+void
+Flipbook::bind( GLuint textureUnit ) const
+{
+    glActiveTexture( GL_TEXTURE0 + textureUnit );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, mTextureID );
+    glActiveTexture( GL_TEXTURE0 );
+}
+
+void
+Flipbook::unbind( GLuint textureUnit ) const
+{
+    glActiveTexture( GL_TEXTURE0 + textureUnit );
+    glBindTexture( GL_TEXTURE_2D_ARRAY, 0 );
+    glActiveTexture( GL_TEXTURE0 );
+}
+
+void
+Flipbook::draw( const size_t layer, const Rectf &rect ) const
+{
+    if ( !mDrawShader ) mDrawShader = gl::GlslProg( DRAW_VERT, DRAW_FRAG );
+
+    bind();
+    mDrawShader.bind();
+    mDrawShader.uniform( "tex", 0 );
+    mDrawShader.uniform( "layer", (float)layer );
+    gl::drawSolidRect( rect );
+    mDrawShader.unbind();
+    unbind();
+}
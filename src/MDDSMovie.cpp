@@ -3,6 +3,8 @@
 #include "cinder/Utilities.h"
 #include "cinder/CinderMath.h"
 
+#include <algorithm>
+
 using namespace std;
 using namespace ci;
 using namespace mdds;
@@ -11,7 +13,7 @@ using namespace mdds;
  * Construction
  */
 
-Movie::Movie( const fs::path &directory, const std::string &extension, const double fps ) :
+Movie::Movie( const double fps ) :
 mThreadIsRunning( false ),
 mDataIsFresh( false ),
 mLoopEnabled( true ),
@@ -24,10 +26,44 @@ mNextFrameTime( app::getElapsedSeconds() ),
 mInterruptTriggeredFoRealz( false ),
 mCurrentFrameIdx( 0 ),
 mCurrentFrameIsFresh( false ),
-mNumFrames( 0 )
+mNumFrames( 0 ),
+mSeekGeneration( 0 ),
+mPrefetchMemoryLimit( 256 * 1024 * 1024 ),
+mTargetUnderrunProbability( 0.01 ),
+mReadLatencyMean( 0 ),
+mReadLatencyVariance( 0 ),
+mFrameSizeMean( 0 ),
+mNumReads( 0 ),
+mUnderruns( 0 ),
+mProxyShuttleRate( 4.0 ),
+mProxyFrameIdx( 0 ),
+mProxyIsFresh( false ),
+mShowingProxy( false ),
+mSeekTime( 0 ),
+mAwaitingFirstPixel( false ),
+mAwaitingFullFrame( false ),
+mSeekTimeToFirstPixel( 0 ),
+mSeekTimeToFullFrame( 0 ),
+mSeekTimeToFirstPixelSum( 0 ),
+mSeekCount( 0 ),
+mVisibleFaces( ::mdds::Texture::FACE_ALL ),
+mIsCubemap( false ),
+mFlipbookLastUpdateTime( 0 ),
+mFlipbookFramePhase( 0 ),
+mSyncSeekThreshold( 15 ),
+mSyncMaxRateCorrection( 0.05 ),
+mClockIsLocked( false ),
+mClockPosition( 0 ),
+mClockRate( 0 ),
+mClockSampleTime( 0 ),
+mClockFramePhase( 0 )
 {
     setPlayRate( 1.0 );
+}
 
+Movie::Movie( const fs::path &directory, const std::string &extension, const double fps ) :
+Movie( fps )
+{
     using namespace ci::fs;
 
     if ( !exists( directory ) ) throw LoadError( directory.string() + " does not exist" );
@@ -39,14 +75,35 @@ mNumFrames( 0 )
 
     readFramePaths();
 
-    mThread                     = thread( bind( &Movie::updateFrameThreadFn, this ) );
+    // A bad first frame is left for the loader to report
+    if ( !mThreadData.framePaths.empty() )
+    {
+        try
+        {
+            mIsCubemap = ::mdds::Texture::readDdsInfo( loadFileStream( mThreadData.framePaths[ 0 ] ) ).isCubemap;
+        }
+        catch ( std::exception & )
+        {
+        }
+    }
+
+    // Set before starting, or the thread can see false and exit straight away
     mThreadIsRunning            = true;
+    mThread                     = thread( bind( &Movie::updateFrameThreadFn, this ) );
+}
+
+Movie::Movie( const FlipbookRef &flipbook ) :
+Movie( flipbook->getFrameRate() )
+{
+    mFlipbook                   = flipbook;
+    mNumFrames                  = flipbook->getNumFrames();
+    mFlipbookLastUpdateTime     = app::getElapsedSeconds();
 }
 
 Movie::~Movie()
 {
     mThreadIsRunning = false;
-    mThread.join();
+    if ( mThread.joinable() ) mThread.join();
 }
 
 
@@ -67,23 +124,63 @@ Movie::warn( const string &warning )
 void
 Movie::update()
 {
+    if ( mFlipbook )
+    {
+        updateFlipbook();
+        return;
+    }
+
+    bool fullFrameIsCurrent = false;
+
     if ( mDataIsFresh )
     {
         {
             lock_guard< mutex > lock( mMutex );
-            mTexture = ::mdds::Texture::loadDds( mThreadData.buffer->createStream(), ::mdds::Texture::Format() );
+            // Frames requested before the last seek are stale, drop them
+            fullFrameIsCurrent = mThreadData.dataGeneration == mSeekGeneration;
+            if ( fullFrameIsCurrent )
+                mTexture = ::mdds::Texture::loadDds( mThreadData.data, ::mdds::Texture::Format(), mTexture );
         }
 
-        if ( mTexture == nullptr ) warn( "error creating texture" );
+        if ( fullFrameIsCurrent && mTexture == nullptr ) warn( "error creating texture" );
         	
         mDataIsFresh = false;
     }
+
+    if ( fullFrameIsCurrent )
+    {
+        mProxyIsFresh = false;
+        mShowingProxy = false;
+        updateSeekTimes( true );
+    }
+    else if ( mProxyIsFresh )
+    {
+        mProxyIsFresh = false;
+
+        // Known-bad proxy frames leave the last one up, like full frames do
+        size_t frame = mProxyFrameIdx;
+        bool isBadProxyFrame = frame < mBadProxyFrames.size() && mBadProxyFrames[ frame ];
+        if ( mProxy && !mIsCubemap && frame < mProxy->getNumFrames() && !isBadProxyFrame )
+        {
+            try
+            {
+                mProxyTexture = mProxy->loadTexture( frame );
+                mShowingProxy = true;
+                updateSeekTimes( false );
+            }
+            catch ( std::exception &boom )
+            {
+                warn( "proxy frame " + toString( frame ) + ": " + boom.what() );
+            }
+        }
+    }
 }
 
 void
 Movie::draw()
 {
-    if ( mTexture ) gl::draw( mTexture );
+    if ( mFlipbook ) mFlipbook->draw( getFlipbookLayer(), Rectf( 0, 0, mFlipbook->getWidth(), mFlipbook->getHeight() ) );
+    else if ( getTexture() ) gl::draw( getTexture() );
 }
 
 /*******************************************************************************
@@ -136,20 +233,32 @@ Movie::getPlayRate() const
     return mPlayRate;
 }
 
-void
-Movie::readFramePaths()
+vector< fs::path >
+Movie::listFramePaths( const fs::path &directory, const string &extension )
 {
     using namespace ci::fs;
 
-    mThreadData.framePaths.clear();
+    vector< path > framePaths;
 
-    for ( auto it = directory_iterator( mThreadData.directoryPath ); it != directory_iterator(); it++ )
+    for ( auto it = directory_iterator( directory ); it != directory_iterator(); it++ )
     {
-        if ( it->path().extension() != mThreadData.extension ) continue;
+        if ( it->path().extension() != extension ) continue;
 
-        mThreadData.framePaths.push_back( it->path() );
+        framePaths.push_back( it->path() );
     }
 
+    // directory_iterator order is unspecified, and proxies are matched to
+    // frames by index
+    sort( framePaths.begin(), framePaths.end() );
+
+    return framePaths;
+}
+
+void
+Movie::readFramePaths()
+{
+    mThreadData.framePaths = listFramePaths( mThreadData.directoryPath, mThreadData.extension );
+
     mNumFrames = mThreadData.framePaths.size();
 }
 
@@ -164,6 +273,16 @@ Movie::seekToFrame( const size_t frame )
 {
     mCurrentFrameIdx = frame;
     mCurrentFrameIsFresh = true;
+    // Bumped after the index so that the loader never pairs a new generation
+    // with the old position
+    mSeekGeneration++;
+
+    mSeekTime = app::getElapsedSeconds();
+    mAwaitingFirstPixel = true;
+    mAwaitingFullFrame = true;
+    mProxyFrameIdx = frame;
+    mProxyIsFresh = true;
+
     mInterruptTriggeredFoRealz = true;
     lock_guard< mutex > lock( mMutex );
     mInterruptFrameRateSleepCv.notify_all();
@@ -216,42 +335,617 @@ Movie::updateFrameThreadFn()
 
     ci::ThreadSetup threadSetup;
 
+    uint32_t lastGeneration = mSeekGeneration;
+    size_t lastFrame = (size_t)-1;
+    uint8_t lastFaceMask = 0;
+    bool wasPlaying = false;
+
     while ( mThreadIsRunning )
     {
         mNextFrameTime = app::getElapsedSeconds();
-        
-        unique_lock< mutex > lock( mMutex );
-
-        // Read data into memory buffer
-        auto ds_path = DataSourcePath::create( mThreadData.framePaths[ mCurrentFrameIdx ] );
-        mThreadData.buffer = DataSourceBuffer::create( ds_path->getBuffer() );
 
+        ClockSourceRef clock;
+        {
+            lock_guard< mutex > lock( mMutex );
+            clock = mClockSource;
+            mLoaderBadFrames = mBadFrames;
+        }
+        if ( clock ) followClock( clock );
+        else mClockIsLocked = false;
+
+        // Read the generation first so it's never newer than the frame
+        uint32_t generation = mSeekGeneration;
+        size_t frame = mCurrentFrameIdx;
+        uint8_t faceMask = mVisibleFaces;
+        bool shuttling;
+        {
+            lock_guard< mutex > lock( mMutex );
+            shuttling = isShuttling();
+        }
+        // A slow or stopped clock is polled more often than the frame changes,
+        // don't send the same frame again
+        bool frameIsShowing = clock && frame == lastFrame && generation == lastGeneration && faceMask == lastFaceMask;
+        lastFrame = frame;
+        lastFaceMask = faceMask;
 
-        mDataIsFresh = true;
-        updateAverageFps();
+        if ( shuttling && !frameIsShowing )
+        {
+            // Too fast for full frames to keep up, show proxies instead
+            mProxyFrameIdx = frame;
+            mProxyIsFresh = true;
+            wasPlaying = false;
+        }
+        else if ( !frameIsShowing )
+        {
+            ::mdds::Texture::DdsData data;
+            bool haveFrame = takePrefetchedFrame( frame, faceMask, data );
+            // Known-bad frames are skipped, leaving the last good one up
+            if ( !haveFrame && !isBadFrame( frame ) )
+            {
+                if ( wasPlaying && generation == lastGeneration && mPlayRate != 0.0 ) mUnderruns++;
+                haveFrame = readFrame( frame, faceMask, data );
+            }
+
+            if ( haveFrame )
+            {
+                lock_guard< mutex > lock( mMutex );
+                mThreadData.data = data;
+                mThreadData.dataGeneration = generation;
+                mDataIsFresh = true;
+            }
+            wasPlaying = true;
+        }
+        lastGeneration = generation;
+        if ( !frameIsShowing ) updateAverageFps();
 
-        nextFramePosition();
+        // When following a clock, followClock() moves the playhead instead
+        if ( !clock ) nextFramePosition();
 
 
         // FrameRate control, cribbed from AppImplMswBasic.cpp
-        double currentSeconds   = app::getElapsedSeconds();
         double secondsPerFrame  = mPlayRate == 0.0 ? 1.0 : ((1.0 / math< double >::abs( mPlayRate )) / mFrameRate);
+        // Check the clock at least once a frame, even while it's stopped or
+        // crawling
+        if ( clock ) secondsPerFrame = min( secondsPerFrame, 1.0 / mFrameRate );
         mNextFrameTime          = mNextFrameTime + secondsPerFrame;
+
+        // Spend the time until the next frame is due reading ahead
+        if ( !shuttling ) prefetchFrames( secondsPerFrame, faceMask );
+
+        unique_lock< mutex > lock( mMutex );
+        double currentSeconds   = app::getElapsedSeconds();
         if ( mNextFrameTime > currentSeconds )
         {
             int ms = (mNextFrameTime - currentSeconds) * 1000.0;
             mInterruptFrameRateSleepCv.wait_for( lock,
                                                  chrono::milliseconds( ms ),
-                                                 [&]{ return mInterruptTriggeredFoRealz; } );
+                                                 [&]{ return mInterruptTriggeredFoRealz.load(); } );
         }
         mInterruptTriggeredFoRealz = false;
     }
 }
 
+/*******************************************************************************
+ * Prefetch
+ */
+
+// Inverse of the standard normal CDF for the upper tail probability \a p,
+// from Abramowitz & Stegun 26.2.23. Good to about 5e-4.
+static
+double
+upperTailQuantile( double p )
+{
+    p = math< double >::clamp( p, 1e-9, 0.5 );
+    double t = sqrt( -2.0 * log( p ) );
+    return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) / (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+Movie::PrefetchStats
+Movie::getPrefetchStats() const
+{
+    lock_guard< mutex > lock( mMutex );
+    return mPrefetchStats;
+}
+
+void
+Movie::setPrefetchMemoryLimit( const size_t bytes )
+{
+    mPrefetchMemoryLimit = bytes;
+}
+
+size_t
+Movie::getPrefetchMemoryLimit() const
+{
+    return mPrefetchMemoryLimit;
+}
+
+void
+Movie::setTargetUnderrunProbability( const double probability )
+{
+    mTargetUnderrunProbability = probability;
+}
+
+double
+Movie::getTargetUnderrunProbability() const
+{
+    return mTargetUnderrunProbability;
+}
+
+bool
+Movie::readFrame( const size_t frame, const uint8_t faceMask, ::mdds::Texture::DdsData &data )
+{
+    if ( frame >= mThreadData.framePaths.size() || isBadFrame( frame ) ) return false;
+
+    const fs::path &framePath = mThreadData.framePaths[ frame ];
+    double start = app::getElapsedSeconds();
+
+    // Read data into memory, skipping cubemap faces that can't be seen
+    try
+    {
+        data = ::mdds::Texture::readDdsData( loadFileStream( framePath ), faceMask );
+    }
+    catch ( std::exception &boom )
+    {
+        warn( framePath.string() + ": " + boom.what() );
+        return false;
+    }
+
+    double latency = app::getElapsedSeconds() - start;
+    double size = data.getDataSize();
+
+    // Exponentially weighted, so the estimates follow the storage when it
+    // speeds up or slows down
+    static const double alpha = 0.1;
+    if ( mNumReads == 0 )
+    {
+        mReadLatencyMean = latency;
+        mFrameSizeMean = size;
+    }
+    else
+    {
+        double delta = latency - mReadLatencyMean;
+        mReadLatencyMean += alpha * delta;
+        mReadLatencyVariance = (1.0 - alpha) * (mReadLatencyVariance + alpha * delta * delta);
+        mFrameSizeMean += alpha * (size - mFrameSizeMean);
+    }
+    mNumReads++;
+
+    return true;
+}
+
+bool
+Movie::takePrefetchedFrame( const size_t frame, const uint8_t faceMask, ::mdds::Texture::DdsData &data )
+{
+    auto it = mPrefetched.find( frame );
+    if ( it == mPrefetched.end() ) return false;
+
+    // A cubemap read before more faces came into view is missing some
+    const ::mdds::Texture::DdsData &prefetched = it->second;
+    if ( prefetched.info.isCubemap && (faceMask & prefetched.info.faceMask & ~prefetched.faceMask) )
+    {
+        mPrefetched.erase( it );
+        return false;
+    }
+
+    // Left in place, it's evicted once it falls out of the window
+    data = prefetched;
+    return true;
+}
+
+void
+Movie::prefetchFrames( const double secondsPerFrame, const uint8_t faceMask )
+{
+    int direction = mPlayRate == 0.0 ? 0 : (mPlayRate > 0 ? 1 : -1);
+
+    // Read far enough ahead to ride out all but the target fraction of reads
+    double worstLatency = mReadLatencyMean + upperTailQuantile( mTargetUnderrunProbability ) * sqrt( mReadLatencyVariance );
+    size_t wantedDepth = mNumReads == 0 ? 1 : (size_t)ceil( worstLatency / secondsPerFrame );
+    size_t maxDepth = mFrameSizeMean > 0 ? (size_t)(mPrefetchMemoryLimit / mFrameSizeMean) : wantedDepth;
+    size_t depth = min( max< size_t >( wantedDepth, 1 ), min< size_t >( maxDepth, mNumFrames ) );
+
+    // The frames that should be resident: the next one due and those after it
+    vector< size_t > window;
+    for ( size_t frame = mCurrentFrameIdx; window.size() < depth && frame < mNumFrames; frame = stepFrame( frame, direction ) )
+    {
+        if ( find( window.begin(), window.end(), frame ) != window.end() ) break;
+        window.push_back( frame );
+    }
+
+    for ( auto it = mPrefetched.begin(); it != mPrefetched.end(); )
+    {
+        if ( find( window.begin(), window.end(), it->first ) == window.end() ) it = mPrefetched.erase( it );
+        else ++it;
+    }
+
+    for ( size_t frame : window )
+    {
+        if ( !mThreadIsRunning || mInterruptTriggeredFoRealz ) break;
+        if ( mPrefetched.count( frame ) ) continue;
+        // Don't start a read that would make the next frame late
+        if ( app::getElapsedSeconds() + mReadLatencyMean > mNextFrameTime ) break;
+
+        ::mdds::Texture::DdsData data;
+        if ( readFrame( frame, faceMask, data ) ) mPrefetched[ frame ] = data;
+    }
+
+    PrefetchStats stats;
+    stats.readLatency           = mReadLatencyMean;
+    stats.readLatencyDeviation  = sqrt( mReadLatencyVariance );
+    stats.throughput            = mReadLatencyMean > 0 ? mFrameSizeMean / mReadLatencyMean : 0;
+    stats.frameSize             = mFrameSizeMean;
+    stats.depth                 = depth;
+    stats.bufferedFrames        = mPrefetched.size();
+    stats.isBandwidthLimited    = mReadLatencyMean >= secondsPerFrame || wantedDepth > depth;
+    stats.underruns             = mUnderruns;
+    for ( const auto &prefetched : mPrefetched ) stats.memoryUsage += prefetched.second.getDataSize();
+
+    lock_guard< mutex > lock( mMutex );
+    mPrefetchStats = stats;
+}
+
+size_t
+Movie::stepFrame( const size_t frame, const int direction ) const
+{
+    if ( direction == 0 ) return frame;
+
+    if ( direction > 0 && frame + 1 >= mNumFrames ) return mLoopEnabled ? 0 : (size_t)-1;
+    if ( direction < 0 && frame == 0 ) return mLoopEnabled ? mNumFrames - 1 : (size_t)-1;
+
+    return frame + direction;
+}
+
+/*******************************************************************************
+ * Proxy
+ */
+
+void
+Movie::setProxy( const ProxyTrackRef &proxy )
+{
+    if ( proxy && proxy->getNumFrames() != mNumFrames )
+        warn( "proxy track has " + toString( proxy->getNumFrames() ) + " frames, movie has " + toString( mNumFrames ) );
+    if ( proxy && mIsCubemap )
+        warn( "proxy tracks only hold the first face, cubemap movies don't use them" );
+
+    lock_guard< mutex > lock( mMutex );
+    mProxy = proxy;
+}
+
+void
+Movie::setProxyShuttleRate( const double rate )
+{
+    mProxyShuttleRate = rate;
+}
+
+double
+Movie::getProxyShuttleRate() const
+{
+    return mProxyShuttleRate;
+}
+
+bool
+Movie::isShuttling() const
+{
+    return mProxy && !mIsCubemap && math< double >::abs( mPlayRate ) >= mProxyShuttleRate;
+}
+
+double
+Movie::getAverageSeekTimeToFirstPixel() const
+{
+    return mSeekCount == 0 ? 0.0 : mSeekTimeToFirstPixelSum / mSeekCount;
+}
+
+void
+Movie::updateSeekTimes( const bool isFullFrame )
+{
+    double elapsed = app::getElapsedSeconds() - mSeekTime;
+
+    if ( mAwaitingFirstPixel )
+    {
+        mAwaitingFirstPixel = false;
+        mSeekTimeToFirstPixel = elapsed;
+        mSeekTimeToFirstPixelSum += elapsed;
+        mSeekCount++;
+    }
+
+    if ( isFullFrame && mAwaitingFullFrame )
+    {
+        mAwaitingFullFrame = false;
+        mSeekTimeToFullFrame = elapsed;
+    }
+}
+
+/*******************************************************************************
+ * Cubemaps
+ */
+
+void
+Movie::setVisibleFaces( const uint8_t faceMask )
+{
+    mVisibleFaces = faceMask & ::mdds::Texture::FACE_ALL;
+}
+
+uint8_t
+Movie::getVisibleFaces() const
+{
+    return mVisibleFaces;
+}
+
+void
+Movie::setViewDirection( const Vec3f &direction, const float fovDegrees )
+{
+    setVisibleFaces( facesVisibleFrom( direction, fovDegrees ) );
+}
+
+uint8_t
+Movie::facesVisibleFrom( const Vec3f &direction, const float fovDegrees )
+{
+    if ( direction.lengthSquared() == 0.0f ) return ::mdds::Texture::FACE_ALL;
+
+    static const Vec3f axes[6] = {
+        Vec3f( 1, 0, 0 ), Vec3f( -1, 0, 0 ),
+        Vec3f( 0, 1, 0 ), Vec3f( 0, -1, 0 ),
+        Vec3f( 0, 0, 1 ), Vec3f( 0, 0, -1 )
+    };
+    // A face's corners are this far off its axis, so a face is visible when
+    // the cone comes within this angle of the axis
+    static const float faceCornerAngle = atan( sqrt( 2.0f ) );
+
+    Vec3f dir = direction.normalized();
+    float maxAngle = toRadians( fovDegrees ) * 0.5f + faceCornerAngle;
+
+    uint8_t faceMask = 0;
+    for ( int face = 0; face < 6; ++face )
+    {
+        float angle = acos( math< float >::clamp( dir.dot( axes[ face ] ), -1.0f, 1.0f ) );
+        if ( angle < maxAngle ) faceMask |= 1 << face;
+    }
+
+    return faceMask;
+}
+
+/*******************************************************************************
+ * Flipbook
+ */
+
+size_t
+Movie::getFlipbookLayer() const
+{
+    return min< size_t >( mCurrentFrameIdx, mNumFrames - 1 );
+}
+
+void
+Movie::updateFlipbook()
+{
+    double now = app::getElapsedSeconds();
+
+    if ( mCurrentFrameIsFresh )
+    {
+        // Seeked, start counting from the new frame
+        mCurrentFrameIsFresh = false;
+        mFlipbookFramePhase = 0;
+        if ( mCurrentFrameIdx >= mNumFrames ) mCurrentFrameIdx = mNumFrames - 1;
+    }
+    else
+    {
+        mFlipbookFramePhase += (now - mFlipbookLastUpdateTime) * mFrameRate * mPlayRate;
+    }
+    mFlipbookLastUpdateTime = now;
+
+    double steps = floor( mFlipbookFramePhase );
+    mFlipbookFramePhase -= steps;
+    if ( steps == 0 ) return;
+
+    advanceFrames( (int64_t)steps );
+    updateAverageFps();
+}
+
+/*******************************************************************************
+ * Clock following
+ */
+
+void
+Movie::setClockSource( const ClockSourceRef &clock )
+{
+    lock_guard< mutex > lock( mMutex );
+    mClockSource = clock;
+}
+
+ClockSourceRef
+Movie::getClockSource() const
+{
+    lock_guard< mutex > lock( mMutex );
+    return mClockSource;
+}
+
+void
+Movie::setSyncSeekThreshold( const double frames )
+{
+    mSyncSeekThreshold = frames;
+}
+
+double
+Movie::getSyncSeekThreshold() const
+{
+    return mSyncSeekThreshold;
+}
+
+void
+Movie::setSyncMaxRateCorrection( const double fraction )
+{
+    mSyncMaxRateCorrection = fraction;
+}
+
+double
+Movie::getSyncMaxRateCorrection() const
+{
+    return mSyncMaxRateCorrection;
+}
+
+Movie::SyncStats
+Movie::getSyncStats() const
+{
+    lock_guard< mutex > lock( mMutex );
+    return mSyncStats;
+}
+
+void
+Movie::resetSyncStats()
+{
+    lock_guard< mutex > lock( mMutex );
+    mSyncStats = SyncStats();
+}
+
+void
+Movie::followClock( const ClockSourceRef &clock )
+{
+    double now = app::getElapsedSeconds();
+    double reading = clock->getTime();
+    double seekThreshold = mSyncSeekThreshold / mFrameRate;
+
+    // Move on by however much of a frame the last rate covered since the last
+    // reading, so rates below 1 don't step a whole frame every time
+    if ( mCurrentFrameIsFresh || !mClockIsLocked ) mClockFramePhase = 0;
+    else mClockFramePhase += (now - mClockSampleTime) * mFrameRate * mPlayRate;
+    mCurrentFrameIsFresh = false;
+
+    double steps = floor( mClockFramePhase );
+    mClockFramePhase -= steps;
+    if ( steps != 0 && mNumFrames > 0 ) advanceFrames( (int64_t)steps );
+
+    // Alpha-beta filter: a smoothed position and rate that ride out jitter in
+    // the readings, but lock back on when the master jumps
+    static const double alpha = 0.1, beta = 0.005;
+    double dt = now - mClockSampleTime;
+    double predicted = mClockPosition + mClockRate * dt;
+    double residual = reading - predicted;
+    if ( !mClockIsLocked || math< double >::abs( residual ) > seekThreshold || dt <= 0 )
+    {
+        mClockPosition = reading;
+        if ( !mClockIsLocked ) mClockRate = 1.0;
+        mClockIsLocked = true;
+    }
+    else
+    {
+        mClockPosition = predicted + alpha * residual;
+        mClockRate += beta * residual / dt;
+    }
+    mClockSampleTime = now;
+
+    // Compare in frames, going the short way round when looping
+    double numFrames = mNumFrames;
+    double masterFrame = mClockPosition * mFrameRate;
+    if ( mLoopEnabled ) masterFrame = fmod( fmod( masterFrame, numFrames ) + numFrames, numFrames );
+    else masterFrame = math< double >::clamp( masterFrame, 0, numFrames - 1 );
+
+    double error = masterFrame - (double)mCurrentFrameIdx;
+    if ( mLoopEnabled && error > numFrames / 2 ) error -= numFrames;
+    else if ( mLoopEnabled && error < -numFrames / 2 ) error += numFrames;
+
+    // Nudging the rate can't keep up with a master that's stopped or slower
+    // than the largest nudge, so then just show whichever frame it's on
+    double maxCorrection = mSyncMaxRateCorrection;
+    bool seeked = math< double >::abs( error ) > mSyncSeekThreshold;
+    bool stepping = !seeked && math< double >::abs( mClockRate ) < maxCorrection;
+    double correction = 0;
+    if ( seeked || stepping )
+    {
+        // Too far off to catch up smoothly, or too slow to nudge. The loader
+        // is between frames, so nothing in flight needs interrupting.
+        size_t nearest = (size_t)(masterFrame + 0.5);
+        if ( nearest >= mNumFrames ) nearest = mLoopEnabled ? 0 : mNumFrames - 1;
+        mCurrentFrameIdx = nearest;
+        mClockFramePhase = 0;
+    }
+    else
+    {
+        // Close the gap over about a second. Added rather than scaled, so it
+        // pulls the right way when the master plays backwards.
+        correction = math< double >::clamp( error / mFrameRate, -maxCorrection, maxCorrection );
+    }
+
+    mPlayRate = stepping ? 0.0 : mClockRate + correction;
+
+    lock_guard< mutex > lock( mMutex );
+    mSyncStats.error = error;
+    mSyncStats.masterRate = mClockRate;
+    mSyncStats.rateCorrection = correction;
+    mSyncStats.numSamples++;
+    mSyncStats.errorSum += error;
+    mSyncStats.errorSquaredSum += error * error;
+    mSyncStats.maxError = max( mSyncStats.maxError, math< double >::abs( error ) );
+    if ( seeked ) mSyncStats.numSeeks++;
+}
+
+/*******************************************************************************
+ * Verification
+ */
+
+void
+Movie::loadVerificationIndex( const fs::path &path )
+{
+    setVerificationIndex( Verifier::readIndex( path ) );
+}
+
+void
+Movie::setVerificationReport( const Verifier::Report &report )
+{
+    setVerificationIndex( report.getIndex() );
+}
+
+void
+Movie::setVerificationIndex( const Verifier::Index &index )
+{
+    if ( index.isPacked )
+    {
+        // Proxy frames are only ever shown by update(), on this thread
+        mBadProxyFrames.assign( mNumFrames, false );
+        for ( size_t frame : index.frames )
+            if ( frame < mBadProxyFrames.size() ) mBadProxyFrames[ frame ] = true;
+        return;
+    }
+
+    // framePaths is only written by the constructor
+    auto badFrames = make_shared< vector< bool > >( mThreadData.framePaths.size(), false );
+    for ( size_t i = 0; i < mThreadData.framePaths.size(); ++i )
+    {
+        string fileName = mThreadData.framePaths[ i ].filename().string();
+        if ( find( index.fileNames.begin(), index.fileNames.end(), fileName ) != index.fileNames.end() ) (*badFrames)[ i ] = true;
+    }
+
+    lock_guard< mutex > lock( mMutex );
+    mBadFrames = badFrames;
+}
+
+size_t
+Movie::getNumBadFrames() const
+{
+    size_t numBadProxyFrames = count( mBadProxyFrames.begin(), mBadProxyFrames.end(), true );
+
+    lock_guard< mutex > lock( mMutex );
+    return numBadProxyFrames + (mBadFrames ? count( mBadFrames->begin(), mBadFrames->end(), true ) : 0);
+}
+
+bool
+Movie::isBadFrame( const size_t frame ) const
+{
+    return mLoaderBadFrames && frame < mLoaderBadFrames->size() && (*mLoaderBadFrames)[ frame ];
+}
+
 /*******************************************************************************
  * Position control
  */
 
+void
+Movie::advanceFrames( const int64_t steps )
+{
+    int64_t numFrames = mNumFrames;
+    int64_t frame = (int64_t)mCurrentFrameIdx + steps;
+    if ( mLoopEnabled ) frame = ((frame % numFrames) + numFrames) % numFrames;
+    else frame = math< int64_t >::clamp( frame, 0, numFrames - 1 );
+
+    mCurrentFrameIdx = frame;
+}
+
 void
 Movie::nextFramePosition()
 {
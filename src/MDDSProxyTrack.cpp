@@ -0,0 +1,356 @@
+#include "MDDSProxyTrack.h"
+#include "MDDSMovie.h"
+#include "cinder/DataSource.h"
+#include "cinder/Stream.h"
+
+using namespace std;
+using namespace ci;
+using namespace mdds;
+
+// Packed proxy file layout, all values little-endian:
+//   char[4]    "MDDP"
+//   uint32_t   version
+//   uint32_t   number of frames
+//   { uint64_t offset; uint32_t size; } per frame
+//   a complete DXT1 DDS file per frame, at the offsets above
+static const char       PROXY_MAGIC[4]      = { 'M', 'D', 'D', 'P' };
+static const uint32_t   PROXY_VERSION       = 1;
+static const size_t     PROXY_HEADER_SIZE   = 4 + 4 + 4;
+static const size_t     PROXY_ENTRY_SIZE    = 8 + 4;
+
+namespace {
+
+struct Rgb { int r, g, b; };
+
+Rgb
+unpack565( uint16_t c )
+{
+    Rgb result = {
+        ((c >> 11) & 0x1f) * 255 / 31,
+        ((c >> 5) & 0x3f) * 255 / 63,
+        (c & 0x1f) * 255 / 31
+    };
+    return result;
+}
+
+uint16_t
+pack565( const Rgb &c )
+{
+    return ((c.r * 31 + 127) / 255) << 11 | ((c.g * 63 + 127) / 255) << 5 | ((c.b * 31 + 127) / 255);
+}
+
+int
+distanceSq( const Rgb &a, const Rgb &b )
+{
+    int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+    return dr * dr + dg * dg + db * db;
+}
+
+//! Decodes texel \a t of a BC4 block, or of either half of a BC5 block, to
+// 0-255. Signed channels are shifted so that -1 maps to 0.
+int
+decodeRgtcTexel( const uint8_t *block, bool isSigned, uint32_t t )
+{
+    int r0 = isSigned ? (int8_t)block[0] : block[0];
+    int r1 = isSigned ? (int8_t)block[1] : block[1];
+    uint64_t indices = 0;
+    for ( int i = 0; i < 6; ++i ) indices |= (uint64_t)block[2 + i] << (8 * i);
+    uint32_t index = (indices >> (3 * t)) & 7;
+
+    int value;
+    if ( index == 0 ) value = r0;
+    else if ( index == 1 ) value = r1;
+    else if ( r0 > r1 ) value = ((8 - index) * r0 + (index - 1) * r1) / 7;
+    else if ( index < 6 ) value = ((6 - index) * r0 + (index - 1) * r1) / 5;
+    else if ( index == 6 ) value = isSigned ? -127 : 0;
+    else value = isSigned ? 127 : 255;
+
+    return isSigned ? value + 128 : value;
+}
+
+//! Decodes the texel at \a x, \a y from the top mip of the first layer in
+// \a data.
+Rgb
+fetchTexel( const Texture::DdsInfo &info, const uint8_t *data, uint32_t x, uint32_t y )
+{
+    if ( !info.isCompressed )
+    {
+        const uint8_t *p = data + (y * info.width + x) * info.bytesPerPixel;
+        Rgb result = { p[0], p[0], p[0] };
+        if ( info.bytesPerPixel >= 3 ) { result.g = p[1]; result.b = p[2]; }
+        return result;
+    }
+
+    const uint8_t *block = data + ((y >> 2) * ((info.width + 3) >> 2) + (x >> 2)) * info.blockSize;
+    uint32_t t = (y & 3) * 4 + (x & 3);
+
+    switch ( info.dataFormat ) {
+        case GL_COMPRESSED_RED_RGTC1:
+        case GL_COMPRESSED_SIGNED_RED_RGTC1:
+        {
+            int r = decodeRgtcTexel( block, info.dataFormat == GL_COMPRESSED_SIGNED_RED_RGTC1, t );
+            Rgb result = { r, r, r };
+            return result;
+        }
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_SIGNED_RG_RGTC2:
+        {
+            bool isSigned = info.dataFormat == GL_COMPRESSED_SIGNED_RG_RGTC2;
+            Rgb result = { decodeRgtcTexel( block, isSigned, t ), decodeRgtcTexel( block + 8, isSigned, t ), 0 };
+            return result;
+        }
+        case GL_COMPRESSED_RGBA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            // The color block follows 8 bytes of alpha
+            block += 8;
+            break;
+    }
+
+    uint16_t c0 = block[0] | block[1] << 8;
+    uint16_t c1 = block[2] | block[3] << 8;
+    uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | (uint32_t)block[7] << 24;
+    uint32_t index = (indices >> (2 * t)) & 3;
+
+    Rgb a = unpack565( c0 ), b = unpack565( c1 );
+    bool isDxt1 = info.dataFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT || info.dataFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+    bool fourColor = c0 > c1 || !isDxt1;
+    switch ( index ) {
+        case 0: return a;
+        case 1: return b;
+        case 2:
+            if ( fourColor ) { Rgb c = { (2 * a.r + b.r) / 3, (2 * a.g + b.g) / 3, (2 * a.b + b.b) / 3 }; return c; }
+            else { Rgb c = { (a.r + b.r) / 2, (a.g + b.g) / 2, (a.b + b.b) / 2 }; return c; }
+        default:
+            if ( fourColor ) { Rgb c = { (a.r + 2 * b.r) / 3, (a.g + 2 * b.g) / 3, (a.b + 2 * b.b) / 3 }; return c; }
+            else { Rgb c = { 0, 0, 0 }; return c; }
+    }
+}
+
+//! Encodes 16 texels as an opaque DXT1 block, using the corners of their
+// bounding box as endpoints. Crude, but plenty for a proxy.
+void
+encodeDxt1Block( const Rgb texels[16], uint8_t *out )
+{
+    Rgb lo = texels[0], hi = texels[0];
+    for ( int i = 1; i < 16; ++i ) {
+        lo.r = min( lo.r, texels[i].r ); hi.r = max( hi.r, texels[i].r );
+        lo.g = min( lo.g, texels[i].g ); hi.g = max( hi.g, texels[i].g );
+        lo.b = min( lo.b, texels[i].b ); hi.b = max( hi.b, texels[i].b );
+    }
+
+    uint16_t c0 = pack565( hi ), c1 = pack565( lo );
+    uint32_t indices = 0;
+    if ( c0 < c1 ) swap( c0, c1 );
+    if ( c0 != c1 )
+    {
+        Rgb a = unpack565( c0 ), b = unpack565( c1 );
+        Rgb palette[4] = {
+            a, b,
+            { (2 * a.r + b.r) / 3, (2 * a.g + b.g) / 3, (2 * a.b + b.b) / 3 },
+            { (a.r + 2 * b.r) / 3, (a.g + 2 * b.g) / 3, (a.b + 2 * b.b) / 3 }
+        };
+        for ( int i = 0; i < 16; ++i ) {
+            uint32_t best = 0;
+            for ( uint32_t p = 1; p < 4; ++p )
+                if ( distanceSq( texels[i], palette[p] ) < distanceSq( texels[i], palette[best] ) ) best = p;
+            indices |= best << (2 * i);
+        }
+    }
+
+    out[0] = c0 & 0xff; out[1] = c0 >> 8;
+    out[2] = c1 & 0xff; out[3] = c1 >> 8;
+    for ( int i = 0; i < 4; ++i ) out[4 + i] = (indices >> (8 * i)) & 0xff;
+}
+
+//! Writes a minimal header for a single-mip DXT1 DDS file.
+void
+writeDxt1Header( OStreamRef stream, uint32_t width, uint32_t height, uint32_t linearSize )
+{
+    uint32_t header[31] = { 0 };
+    header[0]   = 124;                                  // dwSize
+    header[1]   = 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000;   // CAPS | HEIGHT | WIDTH | PIXELFORMAT | LINEARSIZE
+    header[2]   = height;
+    header[3]   = width;
+    header[4]   = linearSize;
+    header[6]   = 1;                                    // dwMipMapCount
+    header[18]  = 32;                                   // ddpfPixelFormat.dwSize
+    header[19]  = 0x4;                                  // DDPF_FOURCC
+    header[20]  = 0x31545844;                           // DXT1
+    header[26]  = 0x1000;                               // DDSCAPS_TEXTURE
+
+    stream->writeData( "DDS ", 4 );
+    stream->writeData( header, sizeof( header ) );
+}
+
+//! Downsamples every frame in \a framePaths by \a scale and writes them,
+// with the header and frame table, to \a path.
+void
+writeTrack( const vector< fs::path > &framePaths, const fs::path &path, const uint32_t scale )
+{
+    vector< ProxyTrack::FrameEntry > frames( framePaths.size() );
+
+    OStreamRef out = writeFileStream( path );
+    out->writeData( PROXY_MAGIC, 4 );
+    out->writeData( &PROXY_VERSION, 4 );
+    uint32_t numFrames = frames.size();
+    out->writeData( &numFrames, 4 );
+
+    // Reserve the frame table, it's filled in once all offsets are known
+    vector< uint8_t > table( frames.size() * PROXY_ENTRY_SIZE, 0 );
+    if ( !table.empty() ) out->writeData( &table[0], table.size() );
+
+    uint64_t offset = PROXY_HEADER_SIZE + table.size();
+    vector< uint8_t > pixels, blocks;
+    for ( size_t i = 0; i < framePaths.size(); ++i )
+    {
+        Texture::DdsInfo info;
+        try
+        {
+            IStreamRef in = loadFileStream( framePaths[ i ] );
+            info = Texture::readDdsInfo( in );
+            pixels.resize( info.getMipSize( 0 ) );
+            in->readData( &pixels[0], pixels.size() );
+        }
+        catch ( std::exception &boom )
+        {
+            throw ProxyTrack::Error( framePaths[ i ].string() + ": " + boom.what() );
+        }
+
+        uint32_t width = max( 1u, info.width / scale );
+        uint32_t height = max( 1u, info.height / scale );
+        uint32_t blocksWide = (width + 3) >> 2, blocksHigh = (height + 3) >> 2;
+        blocks.resize( blocksWide * blocksHigh * 8 );
+
+        uint8_t *block = &blocks[0];
+        for ( uint32_t by = 0; by < blocksHigh; ++by )
+            for ( uint32_t bx = 0; bx < blocksWide; ++bx, block += 8 )
+            {
+                Rgb texels[16];
+                for ( uint32_t t = 0; t < 16; ++t ) {
+                    uint32_t x = min( bx * 4 + (t & 3), width - 1 ) * scale + scale / 2;
+                    uint32_t y = min( by * 4 + (t >> 2), height - 1 ) * scale + scale / 2;
+                    texels[t] = fetchTexel( info, &pixels[0], min( x, info.width - 1 ), min( y, info.height - 1 ) );
+                }
+                encodeDxt1Block( texels, block );
+            }
+
+        writeDxt1Header( out, width, height, blocks.size() );
+        out->writeData( &blocks[0], blocks.size() );
+
+        frames[ i ].offset = offset;
+        frames[ i ].size = 4 + 124 + blocks.size();
+        offset += frames[ i ].size;
+    }
+
+    for ( size_t i = 0; i < frames.size(); ++i ) {
+        memcpy( &table[ i * PROXY_ENTRY_SIZE ], &frames[ i ].offset, 8 );
+        memcpy( &table[ i * PROXY_ENTRY_SIZE + 8 ], &frames[ i ].size, 4 );
+    }
+    out->seekAbsolute( PROXY_HEADER_SIZE );
+    if ( !table.empty() ) out->writeData( &table[0], table.size() );
+}
+
+}
+
+/*******************************************************************************
+ * Construction
+ */
+
+ProxyTrack::ProxyTrack( const fs::path &path )
+{
+    if ( !fs::exists( path ) ) throw Error( path.string() + " does not exist" );
+
+    mBuffer = DataSourcePath::create( path )->getBuffer();
+    size_t dataSize = mBuffer.getDataSize();
+
+    try
+    {
+        mFrames = readFrameTable( IStreamMem::create( mBuffer.getData(), dataSize ) );
+    }
+    catch ( Error &boom )
+    {
+        throw Error( path.string() + ": " + boom.what() );
+    }
+
+    // The table of a track that was never finished is all zeros. Entries
+    // running past the end are left for loadTexture() to refuse, so that a
+    // verification index can mask them frame by frame.
+    for ( const auto &frame : mFrames )
+        if ( frame.size == 0 ) throw Error( path.string() + " has an empty frame entry" );
+}
+
+vector< ProxyTrack::FrameEntry >
+ProxyTrack::readFrameTable( IStreamRef stream )
+{
+    size_t dataSize = stream->size();
+    char magic[4];
+    if ( dataSize < PROXY_HEADER_SIZE ) throw Error( "not a proxy track" );
+    stream->readData( magic, 4 );
+    if ( memcmp( magic, PROXY_MAGIC, 4 ) != 0 ) throw Error( "not a proxy track" );
+
+    uint32_t version, numFrames;
+    stream->readData( &version, 4 );
+    stream->readData( &numFrames, 4 );
+    if ( version != PROXY_VERSION ) throw Error( "unsupported version " + to_string( version ) );
+    if ( dataSize < PROXY_HEADER_SIZE + numFrames * PROXY_ENTRY_SIZE ) throw Error( "frame table is truncated" );
+
+    vector< FrameEntry > frames( numFrames );
+    for ( auto &frame : frames )
+    {
+        stream->readData( &frame.offset, 8 );
+        stream->readData( &frame.size, 4 );
+    }
+
+    return frames;
+}
+
+/*******************************************************************************
+ * Generation
+ */
+
+void
+ProxyTrack::generate( const fs::path &directory, const fs::path &path, const string &extension, const uint32_t scale )
+{
+    if ( scale == 0 ) throw Error( "proxy scale must be at least 1" );
+
+    vector< fs::path > framePaths = Movie::listFramePaths( directory, extension );
+
+    // Written under a temporary name and only moved into place once every
+    // frame is in, so a frame that can't be read leaves no track behind
+    fs::path tempPath = path.parent_path() / (path.filename().string() + ".tmp");
+    try
+    {
+        writeTrack( framePaths, tempPath, scale );
+        fs::rename( tempPath, path );
+    }
+    catch ( std::exception &boom )
+    {
+        if ( fs::exists( tempPath ) ) fs::remove( tempPath );
+        throw Error( boom.what() );
+    }
+}
+
+fs::path
+ProxyTrack::getDefaultPath( const fs::path &directory )
+{
+    fs::path dir = directory;
+    if ( dir.filename() == "." ) dir = dir.parent_path();
+    return dir.parent_path() / (dir.filename().string() + ".mddp");
+}
+
+/*******************************************************************************
+ * Frames
+ */
+
+Texture
+ProxyTrack::loadTexture( const size_t frame ) const
+{
+    const FrameEntry &entry = mFrames.at( frame );
+    size_t dataSize = mBuffer.getDataSize();
+    if ( entry.offset > dataSize || entry.size > dataSize - entry.offset ) throw Error( "proxy frame " + to_string( frame ) + " is truncated" );
+
+    const uint8_t *data = (const uint8_t *)mBuffer.getData();
+    return Texture::loadDds( IStreamMem::create( data + entry.offset, entry.size ), Texture::Format() );
+}
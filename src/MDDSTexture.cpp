@@ -32,9 +32,8 @@ getMipMappedSize(int bytes_per_pixel, int bytes_per_block, unsigned int w, unsig
 }
 
 
-mdds::Texture
-mdds::Texture::loadDds( ci::IStreamRef ddsStream, mdds::Texture::Format format )
-{
+namespace {
+
 	typedef struct { // DDCOLORKEY
 		uint32_t dw1;
 		uint32_t dw2;
@@ -132,109 +131,355 @@ mdds::Texture::loadDds( ci::IStreamRef ddsStream, mdds::Texture::Format format )
 		uint32_t        dwTextureStage;         // stage in multitexture cascade
 	} ddSurface;
 
-	enum { FOURCC_DXT1 = 0x31545844, FOURCC_DXT3 = 0x33545844, FOURCC_DXT5 = 0x35545844 };
+	typedef struct { // DDS_HEADER_DXT10, follows the header when the FourCC is DX10
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	} ddHeaderDx10;
+
+	enum { FOURCC_DXT1 = 0x31545844, FOURCC_DXT3 = 0x33545844, FOURCC_DXT5 = 0x35545844,
+		FOURCC_ATI1 = 0x31495441, FOURCC_BC4U = 0x55344342, FOURCC_BC4S = 0x53344342,
+		FOURCC_ATI2 = 0x32495441, FOURCC_BC5U = 0x55354342, FOURCC_BC5S = 0x53354342,
+		FOURCC_DX10 = 0x30315844 };
+
+	// The DXGI_FORMATs we know how to upload
+	enum { DXGI_FORMAT_R8G8B8A8_UNORM = 28, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29, DXGI_FORMAT_R8_UNORM = 61,
+		DXGI_FORMAT_BC1_UNORM = 71, DXGI_FORMAT_BC1_UNORM_SRGB = 72, DXGI_FORMAT_BC2_UNORM = 74, DXGI_FORMAT_BC2_UNORM_SRGB = 75,
+		DXGI_FORMAT_BC3_UNORM = 77, DXGI_FORMAT_BC3_UNORM_SRGB = 78, DXGI_FORMAT_BC4_UNORM = 80, DXGI_FORMAT_BC4_SNORM = 81,
+		DXGI_FORMAT_BC5_UNORM = 83, DXGI_FORMAT_BC5_SNORM = 84 };
+
+	enum { DDS_RESOURCE_MISC_TEXTURECUBE = 0x4 };
+
+}
+
+/*******************************************************************************
+ * DdsInfo
+ */
+
+mdds::Texture::DdsInfo::DdsInfo() :
+width( 0 ),
+height( 0 ),
+numMipMaps( 1 ),
+numLayers( 1 ),
+dataFormat( 0 ),
+isCompressed( false ),
+isCubemap( false ),
+faceMask( 0 ),
+bytesPerPixel( 0 ),
+blockSize( 0 ),
+dataOffset( 0 )
+{}
+
+size_t
+mdds::Texture::DdsInfo::getMipSize( uint32_t level ) const
+{
+    return getMipMappedSize( bytesPerPixel, blockSize, width, height, level );
+}
+
+size_t
+mdds::Texture::DdsInfo::getLayerSize() const
+{
+    size_t size = 0;
+    for ( uint32_t i = 0; i < numMipMaps; ++i ) size += getMipSize( i );
+    return size;
+}
+
+size_t
+mdds::Texture::DdsInfo::getDataSize() const
+{
+    return getLayerSize() * numLayers;
+}
+
+size_t
+mdds::Texture::DdsInfo::getLayerOffset( uint32_t layer ) const
+{
+    if ( isCubemap )
+    {
+        // Only the faces that are present are stored, in face order, each
+        // with all of its mipmaps
+        uint32_t stored = 0;
+        for ( uint32_t face = 0; face < layer; ++face )
+            if ( faceMask & (1 << face) ) stored++;
+        layer = stored;
+    }
+    return dataOffset + layer * getLayerSize();
+}
+
+/*******************************************************************************
+ * Loading
+ */
 
+mdds::Texture::DdsInfo
+mdds::Texture::readDdsInfo( ci::IStreamRef ddsStream )
+{
     ddSurface ddsd;
     char filecode[4];
     ddsStream->readData( filecode, 4 );
     if( strncmp( filecode, "DDS ", 4 ) != 0 ) {
-        throw Error( "file does not appear to be a DDS texture: " + string( filecode ) );
+        throw Error( "file does not appear to be a DDS texture: " + string( filecode, 4 ) );
     }
     ddsStream->readData( &ddsd, 124/*sizeof(ddsd)*/ );
-    uint32_t width = ddsd.dwWidth;
-    uint32_t height = ddsd.dwHeight;
-    //int numComponents  = (ddsd.ddpfPixelFormat.dwFourCC == FOURCC_DXT1) ? 3 : 4;
-    uint32_t numMipMaps = ddsd.dwMipMapCount;
-    if (numMipMaps == 0) numMipMaps = 1;
-    int dataFormat;
-    bool is_compressed = true;
-    bool is_cubemap = (ddsd.ddsCaps.dwCaps2 & 0x00000200L)!=0;
-    uint32_t bytes_per_pixel = 0; //only if not compressed
+
+    DdsInfo info;
+    info.width = ddsd.dwWidth;
+    info.height = ddsd.dwHeight;
+    info.numMipMaps = ddsd.dwMipMapCount;
+    if (info.numMipMaps == 0) info.numMipMaps = 1;
+    info.isCompressed = true;
+    info.isCubemap = (ddsd.ddsCaps.dwCaps2 & 0x00000200L)!=0;
+    info.dataOffset = 4 + 124;
     switch( ddsd.ddpfPixelFormat.dwFourCC ) {
+        case FOURCC_DX10:
+        {
+            ddHeaderDx10 dx10;
+            ddsStream->readData( &dx10, 20/*sizeof(dx10)*/ );
+            info.dataOffset += 20;
+            if (dx10.arraySize > 1)
+                throw Error( "texture arrays are not supported" );
+            if (dx10.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+            {
+                info.isCubemap = true;
+                ddsd.ddsCaps.dwCaps2 |= 0x0000FC00L; // DX10 cubemaps always store every face
+            }
+            switch (dx10.dxgiFormat)
+            {
+                case DXGI_FORMAT_BC1_UNORM:
+                    info.dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+                    info.blockSize = 8;
+                    break;
+                case DXGI_FORMAT_BC1_UNORM_SRGB:
+                    info.dataFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+                    info.blockSize = 8;
+                    break;
+                case DXGI_FORMAT_BC2_UNORM:
+                    info.dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+                    info.blockSize = 16;
+                    break;
+                case DXGI_FORMAT_BC2_UNORM_SRGB:
+                    info.dataFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+                    info.blockSize = 16;
+                    break;
+                case DXGI_FORMAT_BC3_UNORM:
+                    info.dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                    info.blockSize = 16;
+                    break;
+                case DXGI_FORMAT_BC3_UNORM_SRGB:
+                    info.dataFormat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+                    info.blockSize = 16;
+                    break;
+                case DXGI_FORMAT_BC4_UNORM:
+                    info.dataFormat = GL_COMPRESSED_RED_RGTC1;
+                    info.blockSize = 8;
+                    break;
+                case DXGI_FORMAT_BC4_SNORM:
+                    info.dataFormat = GL_COMPRESSED_SIGNED_RED_RGTC1;
+                    info.blockSize = 8;
+                    break;
+                case DXGI_FORMAT_BC5_UNORM:
+                    info.dataFormat = GL_COMPRESSED_RG_RGTC2;
+                    info.blockSize = 16;
+                    break;
+                case DXGI_FORMAT_BC5_SNORM:
+                    info.dataFormat = GL_COMPRESSED_SIGNED_RG_RGTC2;
+                    info.blockSize = 16;
+                    break;
+                // No R8G8B8A8_UNORM_SRGB: uncompressed uploads pass one enum
+                // as both internal and pixel format, and GL_SRGB8_ALPHA8
+                // isn't a pixel format
+                case DXGI_FORMAT_R8G8B8A8_UNORM:
+                    info.isCompressed = false;
+                    info.bytesPerPixel = 4;
+                    info.dataFormat = GL_RGBA;
+                    break;
+                case DXGI_FORMAT_R8_UNORM:
+                    info.isCompressed = false;
+                    info.bytesPerPixel = 1;
+                    info.dataFormat = GL_LUMINANCE;
+                    break;
+                default:
+                    throw Error( "unsupported DXGI format " + to_string( dx10.dxgiFormat ) );
+            }
+            break;
+        }
+        case FOURCC_ATI1:
+        case FOURCC_BC4U:
+            info.dataFormat = GL_COMPRESSED_RED_RGTC1;
+            info.blockSize = 8;
+            break;
+        case FOURCC_BC4S:
+            info.dataFormat = GL_COMPRESSED_SIGNED_RED_RGTC1;
+            info.blockSize = 8;
+            break;
+        case FOURCC_ATI2:
+        case FOURCC_BC5U:
+            info.dataFormat = GL_COMPRESSED_RG_RGTC2;
+            info.blockSize = 16;
+            break;
+        case FOURCC_BC5S:
+            info.dataFormat = GL_COMPRESSED_SIGNED_RG_RGTC2;
+            info.blockSize = 16;
+            break;
         case FOURCC_DXT1:
-            dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            info.dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            info.blockSize = 8;
             break;
         case FOURCC_DXT3:
-            dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+            info.dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+            info.blockSize = 16;
             break;
         case FOURCC_DXT5:
-            dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            info.dataFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            info.blockSize = 16;
             break;
         default:
-            is_compressed = false;
-            bytes_per_pixel = ddsd.ddpfPixelFormat.dwRGBBitCount / 8;
-            switch (ddsd.ddpfPixelFormat.dwRGBBitCount) //warning: not all supported
+            info.isCompressed = false;
+            info.bytesPerPixel = ddsd.ddpfPixelFormat.dwRGBBitCount / 8;
+            switch (info.bytesPerPixel) //warning: not all supported
         {
-            case 1: dataFormat = GL_LUMINANCE; break;
-            case 3: dataFormat = GL_RGB; break;
-            case 4: dataFormat = GL_RGBA; break;
+            case 1: info.dataFormat = GL_LUMINANCE; break;
+            case 3: info.dataFormat = GL_RGB; break;
+            case 4: info.dataFormat = GL_RGBA; break;
             default: throw Error( "could not determine pixel format" );
         }
             break;
     }
-    uint32_t blockSize = 0;
-    if (is_compressed)
-        blockSize = (dataFormat == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT) ? 8 : 16;
-    int numLayers = 1;
-    if (is_cubemap)
+    if (info.isCubemap)
     {
-        format.setTarget( GL_TEXTURE_CUBE_MAP );
-        numLayers = 6;
+        // DDSCAPS2_CUBEMAP_POSITIVEX and friends, in GL face order
+        info.faceMask = (ddsd.ddsCaps.dwCaps2 >> 10) & FACE_ALL;
+        if (info.faceMask == 0) info.faceMask = FACE_ALL;
+        info.numLayers = 0;
+        for (int face = 0; face < 6; face++)
+            if (info.faceMask & (1 << face)) info.numLayers++;
     }
-    // how big is it going to be including all mipmaps?
-    //uint32_t bufSize = ( ddsd.dwMipMapCount > 1 ) ? ( ddsd.dwLinearSize * 2 ) : ( ddsd.dwLinearSize ); //this only works in 2D
-    uint32_t bufSize = 0;
-    for (int iMipmap = 0; iMipmap < numMipMaps; iMipmap++)
-        bufSize += getMipMappedSize(bytes_per_pixel, blockSize, width, height, iMipmap);
-    bufSize *= numLayers; //cubemaps have 6 textures
-    shared_ptr<uint8_t> pixels( new uint8_t[bufSize+1], checked_array_deleter<uint8_t>() );
-    ddsStream->readData( pixels.get(), bufSize );
-    //*****************************************************
-    off_t offset = 0;
-    // Create the texture
+
+    return info;
+}
+
+mdds::Texture::DdsData
+mdds::Texture::readDdsData( ci::IStreamRef ddsStream, uint8_t faceMask )
+{
+    DdsData data;
+    data.info = readDdsInfo( ddsStream );
+
+    // Fail cleanly rather than reading past the end of a truncated file
+    uint64_t streamSize = (uint64_t)ddsStream->size();
+    uint64_t expectedSize = data.info.dataOffset + data.info.getDataSize();
+    if ( streamSize < expectedSize )
+        throw Error( "file is truncated: " + to_string( streamSize ) + " bytes, header describes " + to_string( expectedSize ) );
+
+    if ( !data.info.isCubemap )
+    {
+        data.faceMask = 1;
+        data.layers[0] = ci::Buffer( data.info.getLayerSize() );
+        ddsStream->readData( data.layers[0].getData(), data.layers[0].getDataSize() );
+        return data;
+    }
+
+    data.faceMask = faceMask & data.info.faceMask;
+    for ( uint32_t face = 0; face < 6; ++face )
+    {
+        if ( !(data.faceMask & (1 << face)) ) continue;
+
+        data.layers[face] = ci::Buffer( data.info.getLayerSize() );
+        ddsStream->seekAbsolute( data.info.getLayerOffset( face ) );
+        ddsStream->readData( data.layers[face].getData(), data.layers[face].getDataSize() );
+    }
+
+    return data;
+}
+
+mdds::Texture
+mdds::Texture::loadDds( ci::IStreamRef ddsStream, mdds::Texture::Format format )
+{
+    return loadDds( readDdsData( ddsStream ), format );
+}
+
+mdds::Texture
+mdds::Texture::loadDds( const DdsData &data, mdds::Texture::Format format, const Texture &reuse )
+{
+    const DdsInfo &info = data.info;
+    uint32_t width = info.width;
+    uint32_t height = info.height;
+    uint32_t numMipMaps = info.numMipMaps;
+    GLenum dataFormat = info.dataFormat;
+    bool is_compressed = info.isCompressed;
+    bool is_cubemap = info.isCubemap;
+    if (is_cubemap)
+        format.setTarget( GL_TEXTURE_CUBE_MAP );
     GLenum target = format.getTarget();
-    GLuint texID;
-    glGenTextures( 1, &texID );
 
-    Texture result( target, texID, width, height, false );
-    result.mObj->mWidth = width;
-    result.mObj->mHeight = height;
-    result.mObj->mInternalFormat = dataFormat;
+    // Upload into the existing texture when it has the same shape, which
+    // keeps the contents of any faces that aren't in data. Every texture made
+    // here has its GL_TEXTURE_MAX_LEVEL set, so that gives its mip count.
+    bool is_reused = reuse && reuse.mObj->mTarget == target && (uint32_t)reuse.mObj->mWidth == width && (uint32_t)reuse.mObj->mHeight == height && (GLenum)reuse.mObj->mInternalFormat == dataFormat;
+    if (is_reused)
+    {
+        GLint maxLevel = 0;
+        glBindTexture( reuse.mObj->mTarget, reuse.mObj->mTextureID );
+        glGetTexParameteriv( reuse.mObj->mTarget, GL_TEXTURE_MAX_LEVEL, &maxLevel );
+        is_reused = (uint32_t)maxLevel + 1 == numMipMaps;
+    }
+    Texture result = reuse;
+    if (!is_reused)
+    {
+        // Create the texture
+        GLuint texID;
+        glGenTextures( 1, &texID );
+
+        result = Texture( target, texID, width, height, false );
+        result.mObj->mWidth = width;
+        result.mObj->mHeight = height;
+        result.mObj->mInternalFormat = dataFormat;
+    }
     glBindTexture( result.mObj->mTarget, result.mObj->mTextureID );
     glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
-    // load the mipmaps
-    for( int i = 0; i < numMipMaps && (width || height); ++i ) {
-        if( width == 0 )
-            width = 1;
-        if( height == 0 )
-            height = 1;
-        int size = 0;
-        for (int iLayer = 0; iLayer < numLayers; iLayer++)
-        {
-            size = getMipMappedSize(bytes_per_pixel, blockSize, result.mObj->mWidth, result.mObj->mHeight, i);
+
+    int numLayers = is_cubemap ? 6 : 1;
+    for (int iLayer = 0; iLayer < numLayers; iLayer++)
+    {
+        const uint8_t *pixels = (data.faceMask & (1 << iLayer)) ? (const uint8_t *)data.layers[iLayer].getData() : nullptr;
+        // Faces we don't have only need allocating, and only once
+        if (!pixels && is_reused) continue;
+
+        GLenum layerTarget = is_cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + iLayer : target;
+        off_t offset = 0;
+        width = info.width;
+        height = info.height;
+        // load the mipmaps
+        for( int i = 0; i < numMipMaps && (width || height); ++i ) {
+            if( width == 0 )
+                width = 1;
+            if( height == 0 )
+                height = 1;
+            int size = info.getMipSize( i );
+            const uint8_t *mipPixels = pixels ? pixels + offset : nullptr;
             if (is_compressed)
             {
-                if (target == GL_TEXTURE_CUBE_MAP)
-                    glCompressedTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + iLayer, i, dataFormat, width, height, 0, size, pixels.get() + offset );
+                if (is_reused)
+                    glCompressedTexSubImage2D( layerTarget, i, 0, 0, width, height, dataFormat, size, mipPixels );
                 else
-                {
-                    glCompressedTexImage2D( result.mObj->mTarget , i, dataFormat, width, height, 0, size, pixels.get() + offset );
-                }
+                    glCompressedTexImage2D( layerTarget, i, dataFormat, width, height, 0, size, mipPixels );
             }
             else
             {
-                if (target == GL_TEXTURE_CUBE_MAP)
-                    glTexImage2D( GL_TEXTURE_CUBE_MAP_POSITIVE_X + iLayer, i, dataFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, pixels.get() + offset );
+                if (is_reused)
+                    glTexSubImage2D( layerTarget, i, 0, 0, width, height, dataFormat, GL_UNSIGNED_BYTE, mipPixels );
                 else
-                    glTexImage2D( result.mObj->mTarget , i, dataFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, pixels.get() + offset );
+                    glTexImage2D( layerTarget, i, dataFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, mipPixels );
             }
             offset += size;
+            width  >>= 1;
+            height >>= 1;
         }
-        width  >>= 1;
-        height >>= 1;
     }
+    if (is_reused)
+        return result;
+
+    glTexParameteri( result.mObj->mTarget, GL_TEXTURE_MAX_LEVEL, numMipMaps - 1 );
     if( numMipMaps > 1 ) {
-        glTexParameteri( result.mObj->mTarget, GL_TEXTURE_MAX_LEVEL, numMipMaps - 1 );
         glTexParameteri( result.mObj->mTarget, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
         glTexParameteri( result.mObj->mTarget, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR );
     }
@@ -0,0 +1,313 @@
+#include "MDDSVerifier.h"
+#include "MDDSMovie.h"
+#include "MDDSProxyTrack.h"
+#include "cinder/Stream.h"
+#include "cinder/Thread.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <tuple>
+
+using namespace std;
+using namespace ci;
+using namespace mdds;
+
+namespace {
+
+//! Runs \a fn for every index below \a count on \a numThreads threads, one
+// per core if 0.
+void
+parallelFor( const size_t count, const size_t numThreads, const function< void( size_t ) > &fn )
+{
+    atomic< size_t > next( 0 );
+    auto work = [&] {
+        ci::ThreadSetup threadSetup;
+        for ( size_t i = next++; i < count; i = next++ ) fn( i );
+    };
+
+    size_t threadCount = numThreads > 0 ? numThreads : max( 1u, thread::hardware_concurrency() );
+    vector< thread > threads;
+    for ( size_t i = 0; i < min( threadCount, count ); ++i ) threads.push_back( thread( work ) );
+    for ( auto &t : threads ) t.join();
+}
+
+//! Checks the DDS file starting at \a offset in \a stream, of which
+// \a available bytes are there to read.
+void
+checkFrame( IStreamRef stream, const uint64_t offset, const uint64_t available, Verifier::FrameReport &report )
+{
+    report.actualSize = available;
+
+    try
+    {
+        char filecode[4];
+        uint32_t headerSize;
+        stream->seekAbsolute( offset );
+        stream->readData( filecode, 4 );
+        stream->readData( &headerSize, 4 );
+        if ( headerSize != 124 ) throw Texture::Error( "header size is " + to_string( headerSize ) + ", expected 124" );
+
+        stream->seekAbsolute( offset );
+        Texture::DdsInfo info = Texture::readDdsInfo( stream );
+        report.width        = info.width;
+        report.height       = info.height;
+        report.dataFormat   = info.dataFormat;
+        report.numMipMaps   = info.numMipMaps;
+        report.isCubemap    = info.isCubemap;
+        report.expectedSize = info.dataOffset + info.getDataSize();
+
+        // Checked first, the mip count below shifts by up to the size's bits
+        if ( info.width == 0 || info.height == 0 || info.width > 16384 || info.height > 16384 )
+            throw Texture::Error( "implausible size " + to_string( info.width ) + "x" + to_string( info.height ) );
+        uint32_t maxMipMaps = 1;
+        while ( (max( info.width, info.height ) >> maxMipMaps) > 0 ) maxMipMaps++;
+        if ( info.numMipMaps > maxMipMaps )
+            throw Texture::Error( to_string( info.numMipMaps ) + " mipmaps, at most " + to_string( maxMipMaps ) + " possible" );
+
+        if ( report.expectedSize > available )
+        {
+            report.status = Verifier::FRAME_TRUNCATED;
+            report.message = to_string( available ) + " bytes, header describes " + to_string( report.expectedSize );
+        }
+    }
+    catch ( Texture::Error &boom )
+    {
+        report.status = Verifier::FRAME_BAD_HEADER;
+        report.message = boom.what();
+    }
+    catch ( std::exception &boom )
+    {
+        // Ran out of file before the end of the header
+        report.status = available < 4 + 124 ? Verifier::FRAME_TRUNCATED : Verifier::FRAME_UNREADABLE;
+        report.message = available < 4 + 124 ? "too short to hold a header" : boom.what();
+    }
+}
+
+//! Flags readable frames that don't match the most common size and format.
+void
+markMismatches( Verifier::Report &report )
+{
+    typedef tuple< uint32_t, uint32_t, GLenum, uint32_t, bool > Shape;
+    auto shapeOf = []( const Verifier::FrameReport &frame ) {
+        return Shape( frame.width, frame.height, frame.dataFormat, frame.numMipMaps, frame.isCubemap );
+    };
+
+    map< Shape, size_t > counts;
+    for ( const auto &frame : report.frames )
+        if ( frame.status == Verifier::FRAME_OK ) counts[ shapeOf( frame ) ]++;
+    if ( counts.size() < 2 ) return;
+
+    auto common = counts.begin();
+    for ( auto it = counts.begin(); it != counts.end(); ++it )
+        if ( it->second > common->second ) common = it;
+
+    for ( auto &frame : report.frames )
+    {
+        if ( frame.status != Verifier::FRAME_OK || shapeOf( frame ) == common->first ) continue;
+
+        frame.status = Verifier::FRAME_MISMATCHED;
+        frame.message = to_string( frame.width ) + "x" + to_string( frame.height ) + " format " + to_string( frame.dataFormat ) +
+                        ", most frames are " + to_string( get< 0 >( common->first ) ) + "x" + to_string( get< 1 >( common->first ) ) +
+                        " format " + to_string( get< 2 >( common->first ) );
+    }
+}
+
+}
+
+/*******************************************************************************
+ * Scanning
+ */
+
+Verifier::Report
+Verifier::scanSequence( const fs::path &directory, const string &extension, const size_t numThreads )
+{
+    if ( !fs::exists( directory ) ) throw Error( directory.string() + " does not exist" );
+    if ( !fs::is_directory( directory ) ) throw Error( directory.string() + " is not a directory" );
+
+    vector< fs::path > framePaths = Movie::listFramePaths( directory, extension );
+
+    Report report;
+    report.frames.resize( framePaths.size() );
+    parallelFor( framePaths.size(), numThreads, [&]( size_t i ) {
+        FrameReport &frame = report.frames[ i ];
+        frame.frame = i;
+        frame.path = framePaths[ i ];
+
+        try
+        {
+            uint64_t size = fs::file_size( frame.path );
+            checkFrame( loadFileStream( frame.path ), 0, size, frame );
+        }
+        catch ( std::exception &boom )
+        {
+            frame.status = FRAME_UNREADABLE;
+            frame.message = boom.what();
+        }
+    } );
+
+    markMismatches( report );
+    return report;
+}
+
+Verifier::Report
+Verifier::scanProxyTrack( const fs::path &path, const size_t numThreads )
+{
+    if ( !fs::exists( path ) ) throw Error( path.string() + " does not exist" );
+
+    uint64_t fileSize = fs::file_size( path );
+    vector< ProxyTrack::FrameEntry > entries;
+    try
+    {
+        entries = ProxyTrack::readFrameTable( loadFileStream( path ) );
+    }
+    catch ( ProxyTrack::Error &boom )
+    {
+        throw Error( path.string() + ": " + boom.what() );
+    }
+
+    Report report;
+    report.isPacked = true;
+    report.frames.resize( entries.size() );
+    parallelFor( entries.size(), numThreads, [&]( size_t i ) {
+        FrameReport &frame = report.frames[ i ];
+        frame.frame = i;
+        frame.path = path;
+
+        const ProxyTrack::FrameEntry &entry = entries[ i ];
+        uint64_t available = entry.offset < fileSize ? min< uint64_t >( entry.size, fileSize - entry.offset ) : 0;
+
+        try
+        {
+            checkFrame( loadFileStream( path ), entry.offset, available, frame );
+        }
+        catch ( std::exception &boom )
+        {
+            frame.status = FRAME_UNREADABLE;
+            frame.message = boom.what();
+        }
+    } );
+
+    markMismatches( report );
+    return report;
+}
+
+/*******************************************************************************
+ * Reports
+ */
+
+const char *
+Verifier::getStatusName( const Status status )
+{
+    switch ( status ) {
+        case FRAME_OK:          return "ok";
+        case FRAME_UNREADABLE:  return "unreadable";
+        case FRAME_BAD_HEADER:  return "bad header";
+        case FRAME_TRUNCATED:   return "truncated";
+        case FRAME_MISMATCHED:  return "mismatched";
+    }
+    return "unknown";
+}
+
+size_t
+Verifier::Report::getNumBadFrames() const
+{
+    size_t count = 0;
+    for ( const auto &frame : frames )
+        if ( frame.status != FRAME_OK ) count++;
+    return count;
+}
+
+void
+Verifier::Report::write( ostream &os ) const
+{
+    os << "Scanned " << frames.size() << " frames, " << getNumBadFrames() << " bad" << endl;
+
+    for ( const auto &frame : frames )
+    {
+        if ( frame.status == FRAME_OK ) continue;
+
+        os << "  frame " << frame.frame << " " << frame.path.filename().string() << ": " << getStatusName( frame.status ) << ": " << frame.message << endl;
+    }
+}
+
+/*******************************************************************************
+ * Index
+ */
+
+// The first line says whether the index is for a sequence or a packed file.
+// Then one bad frame per line: position, file name, status and message,
+// separated by tabs. Lines starting with # are comments.
+static const string INDEX_SEQUENCE  = "mddv sequence";
+static const string INDEX_PACKED    = "mddv packed";
+
+fs::path
+Verifier::getDefaultIndexPath( const fs::path &path )
+{
+    fs::path p = path;
+    if ( p.filename() == "." ) p = p.parent_path();
+    return p.parent_path() / (p.filename().string() + ".mddv");
+}
+
+Verifier::Index
+Verifier::Report::getIndex() const
+{
+    Index index;
+    index.isPacked = isPacked;
+    for ( const auto &frame : frames )
+    {
+        if ( frame.status == FRAME_OK ) continue;
+
+        index.frames.push_back( frame.frame );
+        index.fileNames.push_back( frame.path.filename().string() );
+    }
+    return index;
+}
+
+void
+Verifier::Report::writeIndex( const fs::path &path ) const
+{
+    ofstream os( path.string().c_str() );
+    if ( !os ) throw Error( "could not write " + path.string() );
+
+    os << (isPacked ? INDEX_PACKED : INDEX_SEQUENCE) << endl;
+    os << "# " << frames.size() << " frames, " << getNumBadFrames() << " bad" << endl;
+    for ( const auto &frame : frames )
+    {
+        if ( frame.status == FRAME_OK ) continue;
+
+        string message = frame.message;
+        replace( message.begin(), message.end(), '\n', ' ' );
+        os << frame.frame << '\t' << frame.path.filename().string() << '\t' << getStatusName( frame.status ) << '\t' << message << endl;
+    }
+}
+
+Verifier::Index
+Verifier::readIndex( const fs::path &path )
+{
+    ifstream is( path.string().c_str() );
+    if ( !is ) throw Error( "could not read " + path.string() );
+
+    Index index;
+    string line;
+    getline( is, line );
+    if ( line == INDEX_PACKED ) index.isPacked = true;
+    else if ( line != INDEX_SEQUENCE ) throw Error( path.string() + " is not a verification index" );
+
+    while ( getline( is, line ) )
+    {
+        if ( line.empty() || line[0] == '#' ) continue;
+
+        size_t nameStart = line.find( '\t' );
+        if ( nameStart == string::npos ) throw Error( path.string() + ": malformed line \"" + line + "\"" );
+        size_t nameEnd = line.find( '\t', nameStart + 1 );
+
+        index.frames.push_back( strtoull( line.c_str(), nullptr, 10 ) );
+        index.fileNames.push_back( line.substr( nameStart + 1, nameEnd == string::npos ? string::npos : nameEnd - nameStart - 1 ) );
+    }
+
+    return index;
+}